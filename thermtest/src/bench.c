@@ -0,0 +1,755 @@
+// bench.c
+
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <sys/time.h>
+#include "thermreg.h"
+#include "thermreg_bank.h"
+#include "sim_nozzle.h"
+#include "sim_nozzle_bank.h"
+#include "disturb.h"
+#include "sim_net.h"
+
+
+#define _0C 273.15F
+
+// length of precomputed input temperature table (cycles)
+#define BENCH_INPUT_LEN 64
+
+// closed loop heat-up of bench_thermreg_antiwindup - settle band [K], allowed excess of peak [K] and settle time [s] of
+// leaky integrator over sliding window
+#define BENCH_SETTLE_BAND 1.0F
+#define BENCH_PEAK_TOL 0.5F
+#define BENCH_SETTLE_TOL 5.0F
+
+// regulator type with buffer capacity for parameters used in main.c
+THERMREG_DEFINE(bench_reg_t, 90, 200);
+
+
+static double time_s(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// initialize regulator with the same parameters as main.c
+static void bench_thermreg_init(thermreg_t* pr, int leaky, int pblk)
+{
+	memset(pr, 0, sizeof(thermreg_t));
+	thermreg_init(pr, 0.01, 38, 44, -40, 90, 5+_0C, 295+_0C, 0+_0C, 300+_0C, 9, 24.5, 10, 200, -15, 15);
+	if (leaky)
+		thermreg_leaky_init(pr);
+	if (pblk > 1)
+		thermreg_decim_init(pr, pr->pbufl / pblk, pblk);
+}
+
+// fill input table - temperature oscillating around target, different phase and offset for each zone
+static float* bench_input(int n)
+{
+	float* in = malloc(BENCH_INPUT_LEN * n * sizeof(float));
+	int k, l;
+	for (k = 0; k < BENCH_INPUT_LEN; k++)
+		for (l = 0; l < n; l++)
+			in[k * n + l] = _0C + 245 + (l % 10) + 3 * sinf(6.2831853F * (k + l) / BENCH_INPUT_LEN);
+	return in;
+}
+
+// sensor limits of lane - lanes 8..15 of each 16 have inverted sensor sense (Tss > Tmax, like thermistor with pull-down),
+// lanes 16..31 of each 32 have Tmin below Tss (sensor short circuit is not overridden by mintemp)
+static void bench_fault_limits(thermreg_t* pr, int l)
+{
+	if ((l % 16) >= 8)
+	{
+		pr->Tss = 310 + _0C;
+		pr->Tso = 10 + _0C;
+	}
+	if ((l % 32) >= 16)
+		pr->Tmin = -10 + _0C;
+}
+
+// inject input limit fault - lanes 4..7 of each 8 get one out of range temperature in verification pass (other lanes
+// stay healthy): sensor short circuit, sensor out, mintemp and maxtemp (in inverted lanes MAXTEMP/MINTEMP override
+// sensor errors - the same priority as thermreg_input), returns injected temperature or 'Tc'
+static float bench_fault(int l, int k, int ncycles, float Tc)
+{
+	static const float Tf[2][4] = {{0, 300, 4, 296}, {310, 8, 4, 296}}; // SHC, OUT, MINTEMP, MAXTEMP [C]
+	if (((l % 8) < 4) || (k != ncycles / 2 + (l % 64)))
+		return Tc;
+	return _0C + Tf[(l % 16) >= 8][l % 4];
+}
+
+static int bench_compare(thermreg_bank_t* pb, bench_reg_t* regs)
+{
+	int l;
+	int errors = 0;
+	for (l = 0; l < pb->n; l++)
+	{
+		if (memcmp(&pb->P[l], &regs[l].reg.P, sizeof(float))) errors++;
+		if (memcmp(&pb->Pc[l], &regs[l].reg.Pc, sizeof(float))) errors++;
+		if (memcmp(&pb->Pda[l], &regs[l].reg.Pda, sizeof(float))) errors++;
+		if (memcmp(&pb->ebufs[l], &regs[l].reg.ebufs, sizeof(float))) errors++;
+		if (pb->error[l] != regs[l].reg.error) errors++;
+	}
+	return errors;
+}
+
+int bench_thermreg_bank(int n, int ncycles, int leaky, int pblk)
+{
+	bench_reg_t* regs = malloc(n * sizeof(bench_reg_t));
+	thermreg_bank_t bank;
+	float* in = bench_input(n);
+	int errors = 0;
+	int k, l;
+	for (l = 0; l < n; l++)
+	{
+		bench_thermreg_init(&regs[l].reg, leaky, pblk);
+		regs[l].reg.Tt = _0C + 250 + (l % 10);
+		regs[l].reg.kP = 44 + (l % 7); // vary gains between zones
+		if ((l % 4) == 3)
+			regs[l].reg.kI = -regs[l].reg.kI; // positive kI in lanes 3 of each 4 (leaky anti-windup is active)
+		bench_fault_limits(&regs[l].reg, l);
+	}
+	thermreg_bank_init(&bank, n, &regs[0].reg);
+	for (l = 0; l < n; l++)
+	{
+		bank.Tt[l] = regs[l].reg.Tt;
+		bank.kP[l] = regs[l].reg.kP;
+		bank.kI[l] = regs[l].reg.kI;
+		bank.Tss[l] = regs[l].reg.Tss;
+		bank.Tso[l] = regs[l].reg.Tso;
+		bank.Tmin[l] = regs[l].reg.Tmin;
+	}
+	// verification pass - compare all outputs after every cycle, input limit faults are injected in some lanes
+	float* Tf = malloc(n * sizeof(float));
+	for (k = 0; k < ncycles; k++)
+	{
+		float* Tc = in + (k % BENCH_INPUT_LEN) * n;
+		for (l = 0; l < n; l++)
+		{
+			Tf[l] = bench_fault(l, k, ncycles, Tc[l]);
+			thermreg_input(&regs[l].reg, Tf[l]);
+			thermreg_cycle(&regs[l].reg);
+			thermreg_check(&regs[l].reg);
+		}
+		thermreg_bank_input(&bank, Tf);
+		thermreg_bank_cycle(&bank);
+		thermreg_bank_check(&bank);
+		errors += bench_compare(&bank, regs);
+	}
+	int trips[thermreg_error_PDPOSLIM + 1] = {0};
+	for (l = 0; l < n; l++)
+		trips[bank.error[l]]++;
+	printf("thermreg_bank%s%s: %d zones, %d cycles, lane width %d, %d mismatches\n", leaky?" (leaky integrator)":"", (pblk > 1)?" (decimating averager)":"", n, ncycles, THERMREG_BANK_WIDTH, errors);
+	printf("  lane errors: OK %d, SENSOR_SHC %d, SENSOR_OUT %d, MINTEMP %d, MAXTEMP %d, PDNEGLIM %d, PDPOSLIM %d\n", trips[0], trips[1], trips[2], trips[3], trips[4], trips[5], trips[6]);
+	// clear errors of fault lanes before timed passes (all lanes regulate)
+	thermreg_bank_reset(&bank);
+	for (l = 0; l < n; l++)
+	{
+		thermreg_reset(&regs[l].reg);
+		regs[l].reg.Tt = bank.Tt[l] = _0C + 250 + (l % 10);
+	}
+	free(Tf);
+	// timed scalar pass
+	double t0 = time_s();
+	for (k = 0; k < ncycles; k++)
+	{
+		float* Tc = in + (k % BENCH_INPUT_LEN) * n;
+		for (l = 0; l < n; l++)
+		{
+			thermreg_input(&regs[l].reg, Tc[l]);
+			thermreg_cycle(&regs[l].reg);
+			thermreg_check(&regs[l].reg);
+		}
+	}
+	double t1 = time_s();
+	// timed bank pass
+	for (k = 0; k < ncycles; k++)
+	{
+		float* Tc = in + (k % BENCH_INPUT_LEN) * n;
+		thermreg_bank_input(&bank, Tc);
+		thermreg_bank_cycle(&bank);
+		thermreg_bank_check(&bank);
+	}
+	double t2 = time_s();
+	double zc = (double)n * ncycles;
+	printf("  scalar thermreg_t  %12.0f zones/s\n", zc / (t1 - t0));
+	printf("  thermreg_bank_t    %12.0f zones/s  (%.1fx)\n", zc / (t2 - t1), (t1 - t0) / (t2 - t1));
+	thermreg_bank_done(&bank);
+	free(regs);
+	free(in);
+	return errors;
+}
+
+// pseudo random number 0..1 (deterministic, local state)
+static float bench_rand(unsigned int* seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return ((*seed >> 8) & 0xffff) / 65535.0F;
+}
+
+// one explicit Euler step of nozzle model in double - reference of both float paths (x = Th, T, Ts)
+static void bench_sim_nozzle_ref(double* x, const sim_nozzle_t* ps, double dt)
+{
+	double dhb = x[0] - x[1]; // heater - heat block temperature difference
+	double dba = x[1] - ps->Ta; // heat block - ambient temperature difference
+	double dbs = x[1] - x[2]; // heat block - sensor temperature difference
+	x[0] += dt * (ps->P - dhb / ps->Rh) / ps->Ch;
+	x[1] += dt * (dhb / ps->Rh - dba / ps->R - dbs / ps->Rs - (double)ps->Ex * ps->vex) / ps->C;
+	x[2] += dt * dbs / ((double)ps->Cs * ps->Rs);
+}
+
+int bench_sim_nozzle_bank(int n, float seconds)
+{
+	sim_nozzle_t* sims = malloc(n * sizeof(sim_nozzle_t));
+	double* ref = malloc(3 * n * sizeof(double)); // double reference state of each nozzle
+	sim_nozzle_bank_t bank;
+	float dt = 0.01F;
+	int nsteps = (int)(seconds / dt + 0.5F);
+	int pstep = 100; // heater power changes every 'pstep' steps
+	unsigned int seed = 1;
+	int i, k, s;
+	for (i = 0; i < n; i++)
+	{
+		sim_nozzle_init(&sims[i]);
+		// vary parameters +-20%
+		sims[i].C *= 0.8F + 0.4F * bench_rand(&seed);
+		sims[i].R *= 0.8F + 0.4F * bench_rand(&seed);
+		sims[i].Rh *= 0.8F + 0.4F * bench_rand(&seed);
+		sims[i].Rs *= 0.8F + 0.4F * bench_rand(&seed);
+		sims[i].Ex *= 0.8F + 0.4F * bench_rand(&seed);
+		sims[i].vex = 2 * bench_rand(&seed);
+		ref[3 * i] = ref[3 * i + 1] = ref[3 * i + 2] = sims[i].T;
+	}
+	sim_nozzle_t sim0;
+	sim_nozzle_init(&sim0);
+	sim_nozzle_bank_init(&bank, n, &sim0, dt);
+	for (i = 0; i < n; i++)
+		sim_nozzle_bank_set(&bank, i, &sims[i]);
+	// scalar pass
+	double t0 = time_s();
+	for (k = 0; k < nsteps; k += pstep)
+	{
+		for (i = 0; i < n; i++)
+		{
+			sims[i].P = 38.0F * ((k / pstep + i) % 5) / 4;
+			for (s = 0; s < pstep; s++)
+				sim_nozzle_cycle(&sims[i], dt);
+		}
+	}
+	double t1 = time_s();
+	// bank pass
+	for (k = 0; k < nsteps; k += pstep)
+	{
+		for (i = 0; i < n; i++)
+			bank.P[i] = 38.0F * ((k / pstep + i) % 5) / 4;
+		sim_nozzle_bank_cycle(&bank, pstep);
+	}
+	double t2 = time_s();
+	// double reference pass - both float paths are compared with it at the end of each power step
+	float dmax = 0; // maximum difference bank - reference
+	float dmax_s = 0; // maximum difference scalar - reference (information only)
+	sim_nozzle_bank_t bank2;
+	sim_nozzle_bank_init(&bank2, n, &sim0, dt);
+	for (i = 0; i < n; i++)
+	{
+		sims[i].T = sims[i].Th = sims[i].Ts = sims[i].Ta;
+		sim_nozzle_bank_set(&bank2, i, &sims[i]);
+	}
+	for (k = 0; k < nsteps; k += pstep)
+	{
+		for (i = 0; i < n; i++)
+		{
+			sims[i].P = bank2.P[i] = 38.0F * ((k / pstep + i) % 5) / 4;
+			for (s = 0; s < pstep; s++)
+			{
+				sim_nozzle_cycle(&sims[i], dt);
+				bench_sim_nozzle_ref(ref + 3 * i, &sims[i], dt);
+			}
+		}
+		sim_nozzle_bank_cycle(&bank2, pstep);
+		for (i = 0; i < n; i++)
+		{
+			float d = fabs(bank2.Ts[i] - ref[3 * i + 2]);
+			if (d > dmax) dmax = d;
+			d = fabs(sims[i].Ts - ref[3 * i + 2]);
+			if (d > dmax_s) dmax_s = d;
+		}
+	}
+	double ns = (double)n * nsteps * dt;
+	printf("sim_nozzle_bank: %d nozzles, %.0f s, lane width %d, max sensor temperature difference to double reference %.4f K (scalar %.4f K)\n", n, seconds, SIMD_WIDTH, dmax, dmax_s);
+	printf("  scalar sim_nozzle_t  %12.0f nozzle-s/s\n", ns / (t1 - t0));
+	printf("  sim_nozzle_bank_t    %12.0f nozzle-s/s  (%.1fx)\n", ns / (t2 - t1), (t1 - t0) / (t2 - t1));
+	sim_nozzle_bank_done(&bank2);
+	sim_nozzle_bank_done(&bank);
+	free(ref);
+	free(sims);
+	// compensated steps lose at most half ulp of temperature per call (compensation is not kept between calls), this error
+	// decays with slowest time constant (C * R <= 212s), steady state bound is ulp(600K) / 2 * 212s / (pstep * dt) = 0.006K
+	// independent of simulated time, rounding of coefficients adds about 1e-7 relative error of temperature rise
+	return (dmax < 0.01F)?0:1;
+}
+
+int bench_sim_nozzle_exact(float seconds, float dt)
+{
+	sim_nozzle_t se; // exact, 10ms step
+	sim_nozzle_t sl; // exact, long step
+	sim_nozzle_t sf; // explicit Euler, 10ms step
+	float dts = 0.01F; // short step [s]
+	int nsub = (int)(dt / dts + 0.5F); // short steps per long step
+	int nsteps = (int)(seconds / dt + 0.5F);
+	float dmax_l = 0; // maximum difference long step vs short step
+	float dmax_f = 0; // maximum difference Euler vs exact
+	int k, s;
+	sim_nozzle_init(&se);
+	se.vex = 1;
+	sl = sf = se;
+	double t0 = time_s();
+	for (k = 0; k < nsteps; k++)
+	{
+		se.P = sf.P = 38.0F * (k % 5) / 4; // power steps 0-100%
+		for (s = 0; s < nsub; s++)
+			sim_nozzle_cycle(&sf, dts);
+	}
+	double t1 = time_s();
+	for (k = 0; k < nsteps; k++)
+	{
+		sl.P = 38.0F * (k % 5) / 4;
+		sim_nozzle_cycle_exact(&sl, dt);
+	}
+	double t2 = time_s();
+	sim_nozzle_init(&sf);
+	sf.vex = 1;
+	for (k = 0; k < nsteps; k++)
+	{
+		se.P = sf.P = 38.0F * (k % 5) / 4;
+		for (s = 0; s < nsub; s++)
+		{
+			sim_nozzle_cycle_exact(&se, dts);
+			sim_nozzle_cycle(&sf, dts);
+		}
+		if (fabsf(sf.Ts - se.Ts) > dmax_f) dmax_f = fabsf(sf.Ts - se.Ts);
+	}
+	// repeat long step pass for comparison at each step
+	sim_nozzle_init(&sl);
+	sim_nozzle_init(&se);
+	sl.vex = se.vex = 1;
+	for (k = 0; k < nsteps; k++)
+	{
+		sl.P = se.P = 38.0F * (k % 5) / 4;
+		sim_nozzle_cycle_exact(&sl, dt);
+		for (s = 0; s < nsub; s++)
+			sim_nozzle_cycle_exact(&se, dts);
+		if (fabsf(sl.Ts - se.Ts) > dmax_l) dmax_l = fabsf(sl.Ts - se.Ts);
+	}
+	printf("sim_nozzle_exact: %.0f s, step %.2f s, max sensor temperature difference %.4f K (exact 10ms), Euler 10ms vs exact %.4f K\n", seconds, dt, dmax_l, dmax_f);
+	printf("  Euler 10ms step       %12.0f s/s\n", seconds / (t1 - t0));
+	printf("  exact %4.2fs step      %12.0f s/s  (%.1fx)\n", dt, seconds / (t2 - t1), (t1 - t0) / (t2 - t1));
+	return (dmax_l < 0.05F)?0:1;
+}
+
+// inputs of step 'k' of bench_sim_net (change every second)
+static void bench_sim_net_inputs(sim_nozzle_t* ps, int k, float dt)
+{
+	int sec = (int)(k * dt);
+	ps->P = 38.0F * (sec % 5) / 4;
+	ps->vex = (float)(sec % 3);
+	ps->Ta = _0C + 25 + (sec % 7);
+	ps->R = 24.5F * ((sec % 4)?1:0.7F);
+}
+
+int bench_sim_net(float seconds, int n)
+{
+	sim_nozzle_t s;  // reference
+	sim_nozzle_t sx; // exact reference
+	sim_net_t net;
+	int errors = 0;
+	int k, steps = (int)(seconds / 0.01F + 0.5F);
+	// explicit 10ms - bit exact with sim_nozzle_cycle
+	sim_nozzle_init(&s);
+	if (sim_net_nozzle(&net, &s) < 0)
+		return 1;
+	double t0 = time_s();
+	for (k = 0; k < steps; k++)
+	{
+		bench_sim_net_inputs(&s, k, 0.01F);
+		sim_net_nozzle_inputs(&net, &s);
+		sim_net_cycle(&net, 0.01F);
+	}
+	double t1 = time_s();
+	sim_nozzle_init(&s);
+	for (k = 0; k < steps; k++)
+	{
+		bench_sim_net_inputs(&s, k, 0.01F);
+		sim_nozzle_cycle(&s, 0.01F);
+	}
+	double t2 = time_s();
+	if (memcmp(&net.T[sim_net_nozzle_HEATER], &s.Th, sizeof(float))) errors++;
+	if (memcmp(&net.T[sim_net_nozzle_BLOCK], &s.T, sizeof(float))) errors++;
+	if (memcmp(&net.T[sim_net_nozzle_SENSOR], &s.Ts, sizeof(float))) errors++;
+	sim_net_done(&net);
+	// implicit 10ms and 1s against exact discretization
+	float d10 = 0, d1 = 0;
+	long iters = 0;
+	sim_nozzle_init(&s);
+	sim_net_nozzle(&net, &s);
+	sim_nozzle_init(&sx);
+	double t3 = time_s();
+	for (k = 0; k < steps; k++)
+	{
+		bench_sim_net_inputs(&s, k, 0.01F);
+		bench_sim_net_inputs(&sx, k, 0.01F);
+		sim_net_nozzle_inputs(&net, &s);
+		iters += sim_net_cycle_implicit(&net, 0.01F);
+		sim_nozzle_cycle_exact(&sx, 0.01F);
+		if (fabsf(net.T[sim_net_nozzle_SENSOR] - sx.Ts) > d10) d10 = fabsf(net.T[sim_net_nozzle_SENSOR] - sx.Ts);
+	}
+	double t4 = time_s();
+	sim_net_done(&net);
+	sim_nozzle_init(&s);
+	sim_net_nozzle(&net, &s);
+	sim_nozzle_init(&sx);
+	int steps1 = (int)(seconds + 0.5F);
+	for (k = 0; k < steps1; k++)
+	{
+		bench_sim_net_inputs(&s, k, 1);
+		bench_sim_net_inputs(&sx, k, 1);
+		sim_net_nozzle_inputs(&net, &s);
+		sim_net_cycle_implicit(&net, 1);
+		sim_nozzle_cycle_exact(&sx, 1);
+		if (fabsf(net.T[sim_net_nozzle_SENSOR] - sx.Ts) > d1) d1 = fabsf(net.T[sim_net_nozzle_SENSOR] - sx.Ts);
+	}
+	sim_net_done(&net);
+	// stiff sensor node - explicit 50ms step is unstable, implicit stays close to exact
+	float dse = 0, dsi = 0;
+	sim_net_t ne;
+	sim_nozzle_init(&s);
+	s.Cs /= 1000;
+	sim_net_nozzle(&net, &s);
+	sim_net_nozzle(&ne, &s);
+	sx = s;
+	int steps50 = (int)(seconds / 0.05F + 0.5F);
+	for (k = 0; k < steps50; k++)
+	{
+		bench_sim_net_inputs(&s, k, 0.05F);
+		bench_sim_net_inputs(&sx, k, 0.05F);
+		sim_net_nozzle_inputs(&net, &s);
+		sim_net_nozzle_inputs(&ne, &s);
+		sim_net_cycle_implicit(&net, 0.05F);
+		sim_net_cycle(&ne, 0.05F);
+		sim_nozzle_cycle_exact(&sx, 0.05F);
+		if (fabsf(net.T[sim_net_nozzle_SENSOR] - sx.Ts) > dsi) dsi = fabsf(net.T[sim_net_nozzle_SENSOR] - sx.Ts);
+		if (!(fabsf(ne.T[sim_net_nozzle_SENSOR] - sx.Ts) <= dse)) dse = fabsf(ne.T[sim_net_nozzle_SENSOR] - sx.Ts);
+	}
+	sim_net_done(&ne);
+	sim_net_done(&net);
+	// bed plate - n x n grid of nodes, heater under center, edge nodes coupled to ambient
+	int i, j;
+	sim_net_init(&net, n * n + 1, 2 * n * (n - 1) + 4 * n);
+	int amb = sim_net_node(&net, "ambient", 0, _0C + 25);
+	for (i = 0; i < n * n; i++)
+		sim_net_node(&net, "plate", 800.0F / (n * n), _0C + 25);
+	for (i = 0; i < n; i++)
+		for (j = 0; j < n; j++)
+		{
+			int a = 1 + i * n + j;
+			if (j + 1 < n) sim_net_edge(&net, a, a + 1, 0.5F);
+			if (i + 1 < n) sim_net_edge(&net, a, a + n, 0.5F);
+			if ((i == 0) || (j == 0) || (i == n - 1) || (j == n - 1))
+				sim_net_edge(&net, a, amb, 4.0F * n);
+		}
+	sim_net_build(&net);
+	net.P[1 + (n / 2) * n + n / 2] = 200;
+	int bsteps = steps / 100; // 1s steps
+	long biters = 0;
+	double t5 = time_s();
+	for (k = 0; k < bsteps; k++)
+		biters += sim_net_cycle_implicit(&net, 1);
+	double t6 = time_s();
+	sim_net_done(&net);
+	printf("sim_net: %.0f s, explicit vs sim_nozzle_cycle %d mismatches, max sensor temperature difference to exact %.4f K (implicit 10ms), %.4f K (implicit 1s)\n",
+		seconds, errors, d10, d1);
+	printf("  stiff sensor (Cs/1000), 50ms step - max difference to exact: explicit %.4g K, implicit %.4f K\n", dse, dsi);
+	printf("  sim_nozzle_cycle 10ms    %12.0f s/s\n", seconds / (t2 - t1));
+	printf("  sim_net explicit 10ms    %12.0f s/s\n", seconds / (t1 - t0));
+	printf("  sim_net implicit 10ms    %12.0f s/s  (%.1f iterations/step)\n", seconds / (t4 - t3), (double)iters / steps);
+	printf("  bed plate %dx%d implicit 1s %8.0f s/s  (%.1f iterations/step)\n", n, n, bsteps / (t6 - t5), (double)biters / (bsteps?bsteps:1));
+	return errors + ((d10 < 0.05F)?0:1);
+}
+
+int bench_disturb(int n)
+{
+	// known answers of Threefry-2x32-20 (counter, key -> output, counter word 1 is stream)
+	static const uint32_t kat[3][6] = {
+		{0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x6b200159, 0x99ba4efe},
+		{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0x1cb996fc, 0xbb002be7},
+		{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xc4923a9c, 0x483df7a0},
+	};
+	int errors = 0;
+	int i;
+	for (i = 0; i < 3; i++)
+	{
+		uint64_t u = disturb_u64(&kat[i][2], kat[i][1], kat[i][0]);
+		uint64_t ub;
+		disturb_fill_u64(&kat[i][2], kat[i][1], kat[i][0], 1, &ub);
+		if ((u != (kat[i][4] | ((uint64_t)kat[i][5] << 32))) || (ub != u)) errors++;
+	}
+	uint32_t key[2] = {12345, 678};
+	uint64_t* ub = malloc(n * sizeof(uint64_t));
+	uint64_t* us = malloc(n * sizeof(uint64_t));
+	float* nb = malloc(n * sizeof(float));
+	float* ns = malloc(n * sizeof(float));
+	uint32_t ctr0 = 0xfffffff0; // counter wraps around in first batch
+	double t0 = time_s();
+	disturb_fill_u64(key, disturb_stream_NOISE, ctr0, n, ub);
+	double t1 = time_s();
+	for (i = 0; i < n; i++)
+		us[i] = disturb_u64(key, disturb_stream_NOISE, ctr0 + i);
+	double t2 = time_s();
+	disturb_fill_normal(key, disturb_stream_NOISE, ctr0, n, nb);
+	double t3 = time_s();
+	for (i = 0; i < n; i++)
+		ns[i] = disturb_normal(disturb_u64(key, disturb_stream_NOISE, ctr0 + i));
+	double t4 = time_s();
+	double m = 0, v = 0; // moments of normal values
+	for (i = 0; i < n; i++)
+	{
+		if (ub[i] != us[i]) errors++;
+		if (memcmp(&nb[i], &ns[i], sizeof(float))) errors++;
+		m += nb[i];
+		v += (double)nb[i] * nb[i];
+	}
+	m /= n;
+	v = v / n - m * m;
+	printf("disturb: %d values, %d mismatches, normal mean %.4f variance %.4f\n", n, errors, m, v);
+	printf("  scalar u64            %12.0f values/s\n", n / (t2 - t1));
+	printf("  batch u64 (x%d)        %12.0f values/s  (%.1fx)\n", SIMDI_WIDTH, n / (t1 - t0), (t2 - t1) / (t1 - t0));
+	printf("  scalar normal         %12.0f values/s\n", n / (t4 - t3));
+	printf("  batch normal          %12.0f values/s  (%.1fx)\n", n / (t3 - t2), (t4 - t3) / (t3 - t2));
+	free(ns);
+	free(nb);
+	free(us);
+	free(ub);
+	return errors;
+}
+
+// sum of ring buffer values in double (reference without rounding drift), sum of absolute values is returned in 'pabs'
+static double bench_ring_sum(const float* buff, int l, double* pabs)
+{
+	double s = 0;
+	double a = 0;
+	int i; for (i = 0; i < l; i++)
+	{
+		s += buff[i];
+		a += fabs(buff[i]);
+	}
+	*pabs = a;
+	return s;
+}
+
+// closed loop heat-up to 250C for 'seconds', returns peak temperature [C] and settle time [s] (end of last cycle outside
+// +-BENCH_SETTLE_BAND of final temperature - thermtest gains leave steady state error), largest excess of output before
+// limiting over Pmin..Pmax is returned in 'pu'
+static float bench_heatup(int leaky, float kP, float kI, float seconds, float* psettle, float* pu)
+{
+	bench_reg_t reg;
+	thermreg_t* pr = &reg.reg;
+	sim_nozzle_t sim;
+	bench_thermreg_init(pr, leaky, 1);
+	pr->kP = kP;
+	pr->kI = kI;
+	pr->Tt = 250 + _0C;
+	sim_nozzle_init(&sim);
+	float Tpeak = 0;
+	float umax = 0;
+	int k, ncycles = (int)(seconds / pr->dt + 0.5F);
+	float* hist = malloc(ncycles * sizeof(float)); // sensor temperature of each cycle
+	for (k = 0; k < ncycles; k++)
+	{
+		sim_nozzle_cycle(&sim, pr->dt);
+		thermreg_input(pr, sim.Ts);
+		float err = pr->Tt - pr->Tc;
+		thermreg_cycle(pr);
+		thermreg_check(pr);
+		pr->error = thermreg_error_OK; // regulate whole run (check only feeds its buffers)
+		sim.P = pr->P;
+		float u = err * pr->kP + pr->ebufs * pr->kI / pr->ebufl; // output before limiting
+		float x = (u > pr->Pmax)?(u - pr->Pmax):((u < pr->Pmin)?(pr->Pmin - u):0);
+		if (x > umax) umax = x;
+		if (sim.Ts - _0C > Tpeak) Tpeak = sim.Ts - _0C;
+		hist[k] = sim.Ts;
+	}
+	for (k = ncycles - 1; (k >= 0) && (fabsf(hist[k] - hist[ncycles - 1]) <= BENCH_SETTLE_BAND); k--);
+	*psettle = (k + 1) * pr->dt; // end of last cycle outside settle band
+	free(hist);
+	*pu = umax;
+	return Tpeak;
+}
+
+int bench_thermreg_antiwindup(float seconds)
+{
+	// thermtest gains (negative kI, lag compensation) and low gains with integral action (positive kI, settles without
+	// limit cycle - thermtest kP with positive kI oscillates in both modes), output saturates during heat-up in both
+	static const float kP[2] = {44, 1};
+	static const float kI[2] = {-40, 1};
+	int ret = 0;
+	int i; for (i = 0; i < 2; i++)
+	{
+		float tw, tl, uw, ul;
+		float Tw = bench_heatup(0, kP[i], kI[i], seconds, &tw, &uw); // sliding window (reference)
+		float Tl = bench_heatup(1, kP[i], kI[i], seconds, &tl, &ul); // leaky integrator
+		// leaky loop must not overshoot more or settle later than sliding window loop, both must settle within run,
+		// with integral action output before limiting stays within Pmin..Pmax (anti-windup tracks saturated output)
+		int bad = (Tl > Tw + BENCH_PEAK_TOL) || (tl > tw + BENCH_SETTLE_TOL) || (tw >= seconds) || (tl >= seconds);
+		if ((kI[i] > 0) && (ul > 1e-3F * 38))
+			bad = 1;
+		printf("thermreg leaky anti-windup: kP %.0f kI %+.0f, %.0f s heat-up to 250C, peak %.2f C (window %.2f C), settled to +-%.1f K at %.2f s (window %.2f s), max excess %.4f W%s\n",
+			kP[i], kI[i], seconds, Tl, Tw, BENCH_SETTLE_BAND, tl, tw, ul, bad?" FAIL":"");
+		ret += bad;
+	}
+	return ret;
+}
+
+int bench_thermreg_decim(int ncycles)
+{
+	static const int pblk[3] = {2, 4, 8};
+	float* hist = malloc(ncycles * sizeof(float)); // power difference of each check cycle
+	int ret = 0;
+	int i; for (i = 0; i < 3; i++)
+	{
+		bench_reg_t reg;
+		thermreg_t* pr = &reg.reg;
+		bench_thermreg_init(pr, 0, pblk[i]);
+		int nw = pr->pbufl * pr->pblk; // window (check cycles)
+		unsigned int seed = 1;
+		float Tc = 250 + _0C;
+		float P = 10;
+		int bad = 0;
+		double emax = 0; // maximum error against exact moving average [W]
+		double rmax = 0; // maximum ratio of error to bound dPd / (4 * pbufl)
+		int k; for (k = 0; k < ncycles; k++)
+		{
+			// temperature random walk with step of 10K every 300 cycles (sensor jump, spike of Pd), power changes
+			Tc += 0.2F * (bench_rand(&seed) - 0.5F) + (((k % 300) == 150)?((bench_rand(&seed) < 0.5F)?-10:10):0);
+			if ((k % 37) == 0)
+				P = 38 * bench_rand(&seed);
+			pr->Tc = Tc;
+			pr->P = P;
+			thermreg_check_cycle(pr);
+			hist[k] = pr->P - pr->Pc;
+			if (k < nw + pr->pblk) // first pass and filling of buffer
+				continue;
+			// exact moving average of last 'nw' values, range of Pd in oldest block (part of it is still in window)
+			double se = 0, sa = 0;
+			int j; for (j = k - nw + 1; j <= k; j++)
+			{
+				se += hist[j];
+				sa += fabs(hist[j]);
+			}
+			int o = k - pr->pblkc - nw + 1; // first cycle of oldest block
+			float pmin = hist[o], pmax = hist[o];
+			for (j = o + 1; j < o + pr->pblk; j++)
+			{
+				if (hist[j] < pmin) pmin = hist[j];
+				if (hist[j] > pmax) pmax = hist[j];
+			}
+			double e = fabs(pr->Pda - se / nw);
+			double bound = (pmax - pmin) / (4.0 * pr->pbufl);
+			double tol = 2 * nw * FLT_EPSILON * sa / nw; // rounding of running sums (one lap)
+			if (e > bound + tol)
+				bad++;
+			if (e > emax) emax = e;
+			if ((bound > 0) && ((e - tol) / bound > rmax)) rmax = (e - tol) / bound; // error beyond rounding
+		}
+		printf("thermreg decimating averager: pbufl %d, pblk %d, %d check cycles, max error %.4f W, max %.3f x bound dPd / (4 * pbufl), %d over bound\n",
+			pr->pbufl, pr->pblk, ncycles, emax, rmax, bad);
+		ret += bad;
+	}
+	free(hist);
+	return ret;
+}
+
+// compare window sum 's' with exact sum 'se', 'a' - sums of absolute values of last three comparisons (covers one lap)
+// maximum drift and maximum ratio of drift to rounding bound of one lap (2 * l * FLT_EPSILON * sum of |values|) are updated
+static void bench_drift(float s, double se, int l, const double* a, double* pd, double* pr)
+{
+	double d = fabs(s - se);
+	double amax = fmax(a[0], fmax(a[1], a[2]));
+	double r = d / (2 * l * FLT_EPSILON * amax + DBL_MIN);
+	if (d > *pd) *pd = d;
+	if (r > *pr) *pr = r;
+}
+
+int bench_thermreg_soak(float days)
+{
+	bench_reg_t reg;
+	thermreg_t* pr = &reg.reg;
+	sim_nozzle_t sim;
+	bench_thermreg_init(pr, 0, 1);
+	sim_nozzle_init(&sim);
+	float* ebuff = THERMREG_EBUFF(pr);
+	float* pbuff = THERMREG_PBUFF(pr);
+	float en = 0; // naive running sum of error buffer
+	float pn = 0; // naive running sum of power difference buffer
+	double de = 0, dp = 0;   // maximum drift of window sums
+	double dne = 0, dnp = 0; // maximum drift of naive sums
+	double re = 0, rp = 0;   // maximum ratio of drift to one lap bound
+	double rne = 0, rnp = 0;
+	double ae[3] = {0}, ap[3] = {0}; // sums of absolute values in buffers (last three comparisons)
+	int hour = (int)(3600 / pr->dt + 0.5F);
+	int errors = 0;
+	unsigned int seed = 1;
+	int k, ncycles = (int)(days * 86400 / pr->dt + 0.5F);
+	double t0 = time_s();
+	for (k = 0; k < ncycles; k++)
+	{
+		if (k % hour == 0) // new target 200-260C, extrussion on/off
+		{
+			pr->Tt = 200 + 60 * bench_rand(&seed) + _0C;
+			sim_nozzle_set_extrussion_speed(&sim, (bench_rand(&seed) < 0.5F)?0:2 * bench_rand(&seed));
+		}
+		// oldest values (subtracted by naive sums when buffer is full)
+		int ei = pr->ebufi;
+		int pi = pr->pbufi;
+		int pc = pr->pbufc;
+		float eold = (pr->ebufc >= pr->ebufl)?ebuff[ei]:0;
+		float pold = (pc >= pr->pbufl)?pbuff[pi]:0;
+		sim_nozzle_cycle(&sim, pr->dt);
+		thermreg_input(pr, sim.Ts);
+		thermreg_cycle(pr);
+		thermreg_check(pr);
+		sim.P = pr->P;
+		en -= eold;
+		en += ebuff[ei];
+		if ((pr->pbufi != pi) || (pr->pbufc != pc)) // new value in power difference buffer
+		{
+			pn -= pold;
+			pn += pbuff[pi];
+		}
+		if (pr->error != thermreg_error_OK)
+		{
+			errors++;
+			pr->error = thermreg_error_OK;
+		}
+		if (k % 1009 == 0) // compare with exact sums at varying position in buffer lap
+		{
+			int c = (k / 1009) % 3;
+			double se = bench_ring_sum(ebuff, pr->ebufc, &ae[c]);
+			double sp = bench_ring_sum(pbuff, pr->pbufc, &ap[c]);
+			bench_drift(pr->ebufs, se, pr->ebufl, ae, &de, &re);
+			bench_drift(pr->pbufs, sp, pr->pbufl, ap, &dp, &rp);
+			bench_drift(en, se, pr->ebufl, ae, &dne, &rne);
+			bench_drift(pn, sp, pr->pbufl, ap, &dnp, &rnp);
+		}
+	}
+	double t1 = time_s();
+	printf("thermreg soak: %.1f days, %d cycles, %d error detections\n", days, ncycles, errors);
+	printf("  max drift ebufs %10.6f K  %6.2f x bound   (naive running sum %10.6f K  %8.2f x bound)\n", de, re, dne, rne);
+	printf("  max drift pbufs %10.6f W  %6.2f x bound   (naive running sum %10.6f W  %8.2f x bound)\n", dp, rp, dnp, rnp);
+	printf("  %.0f cycles/s (regulator and simulation)\n", ncycles / (t1 - t0));
+	return ((re <= 1) && (rp <= 1))?0:1;
+}
@@ -0,0 +1,61 @@
+// bench.h
+// throughput benchmarks (run with command line argument "bench")
+
+#ifndef _BENCH_H
+#define _BENCH_H
+
+
+// compare thermreg_bank_t against array of scalar thermreg_t - 'n' zones, 'ncycles' regulation cycles
+// verifies bit exact equality of outputs first, then prints zones per second for both paths
+// 'leaky' - regulators with leaky integrator (thermreg_leaky_init) instead of error buffer
+// 'pblk' - block length of decimating averager (thermreg_decim_init, same window), 1 = exact moving average
+// returns number of mismatched values (0 = OK)
+extern int bench_thermreg_bank(int n, int ncycles, int leaky, int pblk);
+
+// compare sim_nozzle_bank_t against array of scalar sim_nozzle_t - 'n' nozzles with varied parameters, 'seconds' of simulated time
+// prints simulated nozzle-seconds per second for both paths and maximum difference of sensor temperature against explicit
+// Euler steps in double (scalar float model rounds heat energy and drifts, its difference is printed for information)
+// returns 0 when bank matches double reference within 0.01K (bound does not depend on simulated time)
+extern int bench_sim_nozzle_bank(int n, float seconds);
+
+// compare sim_nozzle_cycle_exact with long step 'dt' against exact and Euler stepping with 10ms step - 'seconds' of simulated time
+// heater power changes every 'dt', prints maximum differences of sensor temperature and simulated seconds per second
+// returns 0 when exact results with both steps match within 0.05K (float rounding of short steps)
+extern int bench_sim_nozzle_exact(float seconds, float dt);
+
+
+// compare thermal network of sim_net_nozzle against sim_nozzle_t - 'seconds' of simulated time, heater power, extrussion
+// speed, ambient temperature and R change every second
+// explicit steps (sim_net_cycle, 10ms) must be bit exact with sim_nozzle_cycle, implicit steps (sim_net_cycle_implicit, 10ms
+// and 1s) are compared with sim_nozzle_cycle_exact, stiff sensor node (Cs / 1000, time constant 3.4ms) is stepped with 50ms by both integrators
+// then 'n' x 'n' grid of bed plate nodes is stepped, prints simulated seconds per second
+// returns number of mismatched explicit values plus 1 when implicit 10ms step differs from exact by more than 0.05K
+extern int bench_sim_net(float seconds, int n);
+
+// compare SIMD batches of counter-based generator (disturb_fill_u64, disturb_fill_normal) against scalar reference
+// (disturb_u64 per value) for 'n' counters, checks known answers of Threefry-2x32-20 first
+// prints values per second of both paths, returns number of mismatched values (0 = OK)
+extern int bench_disturb(int n);
+
+// closed loop heat-up of leaky integrator regulator with sim_nozzle_t - 'seconds' of simulated time, negative kI (thermtest)
+// and positive kI, compares peak temperature and settle time with sliding window regulator (leaky must not be worse), with
+// positive kI checks that output before limiting stays within Pmin..Pmax, returns number of failed gain sets (0 = OK)
+extern int bench_thermreg_antiwindup(float seconds);
+
+// power difference check with decimating averager (block 2, 4, 8, same window as main.c) against exact moving average of
+// the same power difference values - 'ncycles' check cycles, temperature random walk with 10K steps (spikes of power
+// difference) and power steps, returns number of check cycles where Pda differs by more than dPd / (4 * pbufl) plus
+// rounding of running sums, dPd = range of power difference within oldest block (0 = OK)
+extern int bench_thermreg_decim(int ncycles);
+
+
+// long-duration soak of scalar thermreg_t in closed loop with sim_nozzle_t - 'days' of simulated time (10ms cycle)
+// target temperature and extrussion speed change every hour, window sums (ebufs, pbufs) are compared with exact sums
+// of buffers (double) and with naive running sums (add new, subtract old - accumulate rounding error)
+// prints maximum drift of both and regulation cycles per second
+// returns 0 when drift of window sums stays within rounding bound of one buffer lap, 2 * length * FLT_EPSILON * sum of |values|
+// (maximum over last lap), naive sums exceed this bound after hours of simulated time
+extern int bench_thermreg_soak(float days);
+
+
+#endif // _BENCH_H
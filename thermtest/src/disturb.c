@@ -0,0 +1,170 @@
+// disturb.c
+
+#include "disturb.h"
+#include <math.h>
+#include <string.h>
+#include "simd.h"
+
+
+#define _0C 273.15F
+
+// key schedule parity constant of Threefry
+#define _TF_PARITY 0x1BD11BDA
+
+// scale of sum of four 16-bit uniforms to unit variance - sqrt(12 / (4 * 65536^2))
+#define _NSCALE ((float)(1.7320508075688772 / 65536))
+
+// mean of sum of four 16-bit uniforms
+#define _NMEAN 131070
+
+// one round of Threefry-2x32 with rotation 'r' (operations are macro arguments - scalar or vector)
+#define _TF_ROUND(ADD, ROTL, XOR, r) { x0 = ADD(x0, x1); x1 = ROTL(x1, r); x1 = XOR(x1, x0); }
+
+// key injection 's' (after every 4 rounds)
+#define _TF_INJECT(ADD, SET, s) { x0 = ADD(x0, SET(ks[(s) % 3])); x1 = ADD(x1, SET(ks[((s) + 1) % 3] + (s))); }
+
+// 20 rounds of Threefry-2x32, rotation constants 13, 15, 26, 6, 17, 29, 16, 24
+#define _TF_20(ADD, ROTL, XOR, SET) \
+	_TF_ROUND(ADD, ROTL, XOR, 13) _TF_ROUND(ADD, ROTL, XOR, 15) _TF_ROUND(ADD, ROTL, XOR, 26) _TF_ROUND(ADD, ROTL, XOR, 6) _TF_INJECT(ADD, SET, 1) \
+	_TF_ROUND(ADD, ROTL, XOR, 17) _TF_ROUND(ADD, ROTL, XOR, 29) _TF_ROUND(ADD, ROTL, XOR, 16) _TF_ROUND(ADD, ROTL, XOR, 24) _TF_INJECT(ADD, SET, 2) \
+	_TF_ROUND(ADD, ROTL, XOR, 13) _TF_ROUND(ADD, ROTL, XOR, 15) _TF_ROUND(ADD, ROTL, XOR, 26) _TF_ROUND(ADD, ROTL, XOR, 6) _TF_INJECT(ADD, SET, 3) \
+	_TF_ROUND(ADD, ROTL, XOR, 17) _TF_ROUND(ADD, ROTL, XOR, 29) _TF_ROUND(ADD, ROTL, XOR, 16) _TF_ROUND(ADD, ROTL, XOR, 24) _TF_INJECT(ADD, SET, 4) \
+	_TF_ROUND(ADD, ROTL, XOR, 13) _TF_ROUND(ADD, ROTL, XOR, 15) _TF_ROUND(ADD, ROTL, XOR, 26) _TF_ROUND(ADD, ROTL, XOR, 6) _TF_INJECT(ADD, SET, 5)
+
+// scalar operations
+#define _SADD(a, b)  ((a) + (b))
+#define _SXOR(a, b)  ((a) ^ (b))
+#define _SROTL(a, r) (((a) << (r)) | ((a) >> (32 - (r))))
+#define _SSET(x)     ((uint32_t)(x))
+
+
+// uniform value in <0, 1) from 24 high bits
+static float disturb_uniform(uint32_t u)
+{
+	return (u >> 8) * (1.0F / 16777216);
+}
+
+uint64_t disturb_u64(const uint32_t key[2], uint32_t stream, uint32_t ctr)
+{
+	uint32_t ks[3] = {key[0], key[1], _TF_PARITY ^ key[0] ^ key[1]};
+	uint32_t x0 = ctr + ks[0];
+	uint32_t x1 = stream + ks[1];
+	_TF_20(_SADD, _SROTL, _SXOR, _SSET)
+	return x0 | ((uint64_t)x1 << 32);
+}
+
+void disturb_fill_u64(const uint32_t key[2], uint32_t stream, uint32_t ctr0, int n, uint64_t* out)
+{
+	int i = 0;
+#if (SIMDI_WIDTH > 1)
+	uint32_t ks[3] = {key[0], key[1], _TF_PARITY ^ key[0] ^ key[1]};
+	uint32_t w0[SIMDI_WIDTH];
+	uint32_t w1[SIMDI_WIDTH];
+	for (; i + SIMDI_WIDTH <= n; i += SIMDI_WIDTH)
+	{
+		vu_t x0 = VUSEQ(ctr0 + i + ks[0]); // counters of all lanes
+		vu_t x1 = VUSET(stream + ks[1]);
+		_TF_20(VUADD, VUROTL, VUXOR, VUSET)
+		VUST(w0, x0);
+		VUST(w1, x1);
+		int j; for (j = 0; j < SIMDI_WIDTH; j++)
+			out[i + j] = w0[j] | ((uint64_t)w1[j] << 32);
+	}
+#endif
+	for (; i < n; i++) // remainder
+		out[i] = disturb_u64(key, stream, ctr0 + i);
+}
+
+float disturb_normal(uint64_t u)
+{
+	int s = (int)(u & 0xffff) + (int)((u >> 16) & 0xffff) + (int)((u >> 32) & 0xffff) + (int)(u >> 48);
+	return (s - _NMEAN) * _NSCALE;
+}
+
+void disturb_fill_normal(const uint32_t key[2], uint32_t stream, uint32_t ctr0, int n, float* out)
+{
+	uint64_t u[DISTURB_BATCH];
+	int i; for (i = 0; i < n; i += DISTURB_BATCH)
+	{
+		int m = (n - i < DISTURB_BATCH)?(n - i):DISTURB_BATCH;
+		disturb_fill_u64(key, stream, ctr0 + i, m, u);
+		int j; for (j = 0; j < m; j++)
+			out[i + j] = disturb_normal(u[j]);
+	}
+}
+
+void disturb_init(disturb_t* pd, uint32_t seed, uint32_t id)
+{
+	memset(pd, 0, sizeof(disturb_t));
+	pd->key[0] = seed;
+	pd->key[1] = id;
+	pd->vseg = 10;
+	pd->von = 0.7F;
+	pd->Taper = 600;
+	pd->fanr = 1;
+	pd->fseg = 30;
+	pd->fon = 0.5F;
+	pd->nbt = -1;
+}
+
+void disturb_start(disturb_t* pd, const sim_nozzle_t* ps, float dt)
+{
+	pd->dt = dt;
+	pd->Ta0 = ps->Ta;
+	pd->R0 = ps->R;
+	pd->phase = 6.2831853F * disturb_uniform((uint32_t)disturb_u64(pd->key, disturb_stream_TA, 0));
+	pd->vsi = -1;
+	pd->vcur = 0;
+	pd->fsi = -1;
+	pd->fcur = 1;
+	pd->nbt = -1;
+}
+
+int disturb_enabled(const disturb_t* pd)
+{
+	return (pd->noise > 0) || (pd->adcq > 0) || (pd->vmax > 0) || (pd->Taamp != 0) || ((pd->fanr > 0) && (pd->fanr != 1));
+}
+
+void disturb_plant(disturb_t* pd, sim_nozzle_t* ps, int tick)
+{
+	float t = tick * pd->dt;
+	if (pd->vmax > 0)
+	{
+		int seg = (int)(t / pd->vseg);
+		if (seg != pd->vsi) // new segment - extrussion on with probability 'von', uniform speed
+		{
+			uint64_t u = disturb_u64(pd->key, disturb_stream_VEX, seg);
+			pd->vcur = (disturb_uniform((uint32_t)u) < pd->von)?(pd->vmax * disturb_uniform((uint32_t)(u >> 32))):0;
+			pd->vsi = seg;
+		}
+		sim_nozzle_set_extrussion_speed(ps, pd->vcur);
+	}
+	if ((pd->fanr > 0) && (pd->fanr != 1))
+	{
+		int seg = (int)(t / pd->fseg);
+		if (seg != pd->fsi) // new segment - fan on with probability 'fon'
+		{
+			pd->fcur = (disturb_uniform((uint32_t)disturb_u64(pd->key, disturb_stream_FAN, seg)) < pd->fon)?pd->fanr:1;
+			pd->fsi = seg;
+		}
+		ps->R = pd->R0 * pd->fcur;
+	}
+	if (pd->Taamp != 0)
+		ps->Ta = pd->Ta0 + pd->Taamp * (float)sin(6.283185307179586 * t / pd->Taper + pd->phase);
+}
+
+float disturb_sensor(disturb_t* pd, float T, int tick)
+{
+	if (pd->noise > 0)
+	{
+		if ((pd->nbt < 0) || (tick < pd->nbt) || (tick >= pd->nbt + DISTURB_BATCH))
+		{
+			pd->nbt = tick - tick % DISTURB_BATCH; // next batch (values do not depend on batch alignment)
+			disturb_fill_normal(pd->key, disturb_stream_NOISE, pd->nbt, DISTURB_BATCH, pd->nbuf);
+		}
+		T += pd->noise * pd->nbuf[tick - pd->nbt];
+	}
+	if (pd->adcq > 0)
+		T = _0C + pd->adcq * floorf((T - _0C) / pd->adcq + 0.5F); // quantization of reading in [C]
+	return T;
+}
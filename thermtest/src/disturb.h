@@ -0,0 +1,84 @@
+// disturb.h
+// deterministic disturbance layer for Monte Carlo runs - sensor noise, ADC quantization, extrussion speed profile,
+// ambient drift and fan induced change of R
+// all random values come from counter-based generator (Threefry-2x32-20) keyed by (seed, run id) with counter (tick, stream),
+// each value depends only on its key and counter - any single run is reproduced exactly in isolation, independent
+// of thread count, run order and batch alignment, no global state (thread safe)
+
+#ifndef _DISTURB_H
+#define _DISTURB_H
+
+#include <inttypes.h>
+#include "sim_nozzle.h"
+
+// number of sensor noise values generated in one SIMD batch
+#define DISTURB_BATCH 64
+
+// random streams (second word of counter)
+typedef enum
+{
+	disturb_stream_NOISE = 1,  // sensor noise (counter = tick)
+	disturb_stream_VEX = 2,    // extrussion speed profile (counter = segment)
+	disturb_stream_FAN = 3,    // fan state (counter = segment)
+	disturb_stream_TA = 4,     // phase of ambient drift (counter = 0)
+} disturb_stream_t;
+
+// disturbance configuration and state - flat structure without pointers (part of scenario checkpoint)
+typedef struct
+{
+	uint32_t key[2]; // generator key (seed, run id)
+	// configuration (0 = disturbance disabled)
+	float noise;     // sensor noise standard deviation [K]
+	float adcq;      // ADC quantization step of sensor temperature [K]
+	float vmax;      // maximum extrussion speed of random profile [mm/s] (replaces vex events of scenario)
+	float vseg;      // segment length of extrussion profile [s]
+	float von;       // probability of extrussion in segment (speed uniform in 0..vmax)
+	float Taamp;     // ambient drift amplitude [K] (sine with random phase)
+	float Taper;     // ambient drift period [s]
+	float fanr;      // R factor while fan is on (0 or 1 = no fan)
+	float fseg;      // segment length of fan state [s]
+	float fon;       // probability of fan on in segment
+	// state (disturb_start)
+	float dt;        // simulation step [s]
+	float Ta0;       // nominal ambient temperature of simulator [K]
+	float R0;        // nominal thermal resistance of simulator [K/W]
+	float phase;     // phase of ambient drift [rad]
+	int vsi;         // current segment of extrussion profile (-1 = none)
+	float vcur;      // extrussion speed of current segment [mm/s]
+	int fsi;         // current segment of fan state (-1 = none)
+	float fcur;      // R factor of current segment
+	int nbt;         // first tick of noise batch (-1 = empty)
+	float nbuf[DISTURB_BATCH]; // sensor noise of ticks nbt..nbt+DISTURB_BATCH-1 (standard normal)
+} disturb_t;
+
+
+// both 32-bit words of random block for key, stream and counter (scalar reference), first word in low half
+extern uint64_t disturb_u64(const uint32_t key[2], uint32_t stream, uint32_t ctr);
+
+// random blocks of 'n' consecutive counters ctr0..ctr0+n-1 (SIMD batch, equal to disturb_u64)
+extern void disturb_fill_u64(const uint32_t key[2], uint32_t stream, uint32_t ctr0, int n, uint64_t* out);
+
+// approximately standard normal value of random block (sum of four 16-bit uniforms, bounded to +-3.46)
+extern float disturb_normal(uint64_t u);
+
+// standard normal values of 'n' consecutive counters (SIMD batch)
+extern void disturb_fill_normal(const uint32_t key[2], uint32_t stream, uint32_t ctr0, int n, float* out);
+
+// set all disturbances off, key (seed, run id)
+extern void disturb_init(disturb_t* pd, uint32_t seed, uint32_t id);
+
+// start run - store nominal ambient temperature and resistance of simulator, simulation step 'dt', clear cached values
+// (call after simulator init, before first step)
+extern void disturb_start(disturb_t* pd, const sim_nozzle_t* ps, float dt);
+
+// returns nonzero when any disturbance is enabled
+extern int disturb_enabled(const disturb_t* pd);
+
+// set simulator inputs of step 'tick' (ambient temperature, R, extrussion speed) - call before simulation step
+extern void disturb_plant(disturb_t* pd, sim_nozzle_t* ps, int tick);
+
+// return measured sensor temperature of step 'tick' (true temperature 'T' [K] with noise and ADC quantization)
+extern float disturb_sensor(disturb_t* pd, float T, int tick);
+
+
+#endif // _DISTURB_H
@@ -1,36 +1,79 @@
-
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <math.h>
-#include <conio.h>
 #include "thermreg.h"
 #include "sim_nozzle.h"
+#include "scenario.h"
+#include "trace.h"
+#include "bench.h"
+#include "tune.h"
+#include "sweep.h"
+#include "rt.h"
+#include "replay.h"
+#include "sim_net.h"
 
 
 
 
 unsigned long time_ms(void);
 
-void test0(void); // 0 - target temperature = 250C, OK
-void test1(void); // 1 - target temperature = 250C, utrzene topeni v dobe nahrivani (30s po startu)
-void test2(void); // 2 - target temperature = 250C, utrzene topeni v dobe stabilni teploty (100s po startu)
-void test3(void); // 3 - target temperature = 250C, porucha termistoru v dobe stabilni teploty (100s po startu), ukazuje 260C
-void test4(void); // 4 - target temperature = 250C, porucha termistoru v dobe stabilni teploty (100s po startu), ukazuje 240C
 
+#define _0C 273.15F
 
-sim_nozzle_t sim;
+// maximum number of scenarios loaded from file
+#define MAX_SCENARIOS 256
 
-thermreg_t reg;
+// flight recorder buffer length (samples)
+#define MAX_RECORD 4096
 
+// check parameter grid of sweep and replay -g (model constants around values of init_regulator)
+static const int grid_ncycl[] = {5, 10, 20};
+static const int grid_pbufl[] = {100, 200, 400};
+static const float grid_Pdl[] = {10, 15, 20};
+static const float grid_C[] = {6.5, 9, 11.5};
+static const float grid_R[] = {20, 24.5, 29};
+#define GRID_POINTS (3 * 3 * 3 * 3 * 3)
 
-#define _0C 273.15F
+// regulator options (init_regulator param)
+typedef struct
+{
+	int est;       // online estimation of C and R
+	int leaky;     // leaky integrator instead of error buffer
+	int pblk;      // block length of decimating averager (1 = exact moving average)
+} reg_opts_t;
 
 
-int main(int argc, char**argv)
+// built-in scenario table
+const scenario_t scenarios[] =
+{
+	// name             Tt[C]  duration[s]  events
+	{"ok",              250,   500,         0, {{0, 0, 0}}},
+	{"heater_heatup",   250,   500,         1, {{30, scenario_event_HEATER, 0}}},   // heater disconnected while heating (30s after start)
+	{"heater_stable",   250,   500,         1, {{100, scenario_event_HEATER, 0}}},  // heater disconnected at stable temperature (100s after start)
+	{"sensor_240",      250,   500,         1, {{100, scenario_event_SENSOR, 240}}}, // thermistor failure at stable temperature (100s after start), shows 240C
+	{"sensor_260",      250,   500,         1, {{100, scenario_event_SENSOR, 260}}}, // thermistor failure at stable temperature (100s after start), shows 260C
+	{"r_drift",         250,   800,         1, {{100, scenario_event_R, 0.3F}}},    // no fault - R drifts to 30% from 100s to 800s (fan, airflow), nominal check trips
+};
+
+
+// apply regulator options (after thermreg_init)
+void init_options(thermreg_t* pr, const reg_opts_t* po)
+{
+	if (po && po->leaky)
+		thermreg_leaky_init(pr); // same time constant as error buffer (90 cycles)
+	if (po && (po->pblk > 1))
+		thermreg_decim_init(pr, pr->pbufl / po->pblk, po->pblk); // same window (200 check cycles), pbufl / pblk values
+	if (po && po->est)
+		thermreg_est_init(pr, 0.8F, 50); // online estimation of C and R (5s windows, 25s memory)
+}
+
+// initialize regulator and simulator for one scenario run
+void init_regulator(thermreg_t* pr, sim_nozzle_t* ps, void* param)
 {
-	thermreg_init(&reg,
+	thermreg_init(pr,
 		0.01,     // regulation period [s]
 		38,       // maximum output power [W]
 		44,       // proportional constant
@@ -47,132 +90,543 @@ int main(int argc, char**argv)
 		-15,      // negative power difference limit [W]
 		15        // positive power difference limit [W]
 	);
+	init_options(pr, (const reg_opts_t*)param);
+	sim_nozzle_init(ps);
+}
 
-	sim_nozzle_init(&sim);
+// initialize regulator of thermal network zone - parameters of init_regulator with maximum power and model constants
+// of zone, gains and power difference limits are scaled by ratio of maximum powers
+void init_zone(thermreg_t* pr, const sim_net_zone_t* pz, const reg_opts_t* po)
+{
+	sim_nozzle_t sim;
+	init_regulator(pr, &sim, 0);
+	float k = pz->Pmax / pr->Pmax;
+	thermreg_init(pr, pr->dt, pz->Pmax, pr->kP * k, pr->kI * k, pr->ebufl, pr->Tmin, pr->Tmax, pr->Tss, pr->Tso,
+		pz->C, pz->R, pr->ncycl, pr->pbufl, pr->Pdnl * k, pr->Pdpl * k);
+	init_options(pr, po);
+	pr->Tt = pz->Tt + _0C;
+}
 
-	test4();
+// real-time run of one scenario (rt_run callback argument)
+typedef struct
+{
+	const scenario_t* psc;  // scenario
+	scenario_state_t st;    // state of scenario run
+	scenario_output_t out;  // telemetry output (-o file)
+} rt_scenario_t;
 
-	getch();
+// one regulation cycle of scenario (simulator step, input, cycle, check) per period of real-time loop
+int rt_scenario_cycle(void* arg)
+{
+	rt_scenario_t* prs = (rt_scenario_t*)arg;
+	scenario_advance(prs->psc, &prs->st, prs->st.tick + 1, &prs->out, 0);
 	return 0;
 }
 
+// regulator type for autotune candidates (error buffer up to 256 samples)
+THERMREG_DEFINE(tune_reg_t, 256, 200);
 
-
-void test0(void)
+// autotune candidate - heat-up from ambient to 250C with regulator parameters of init_regulator and candidate gains
+void tune_eval(const tune_param_t* pp, float horizon, tune_result_t* pres, void* arg)
 {
-	float t = 0; // time
-	float dt = 0.01; // delta t
-	float temp = _0C + 250;
-	reg.Tt = temp;
-	while (t < 500)
+	(void)arg; // no shared context - each candidate is self-contained
+	tune_reg_t treg;
+	thermreg_t* pr = &treg.reg;
+	sim_nozzle_t sim;
+	init_regulator(pr, &sim, 0);
+	thermreg_init(pr, pr->dt, pr->Pmax, pp->kP, pp->kI, pp->ebufl, pr->Tmin, pr->Tmax, pr->Tss, pr->Tso, pr->C, pr->R, pr->ncycl, pr->pbufl, pr->Pdnl, pr->Pdpl);
+	pr->Tt = 250 + _0C;
+	tune_meas_t meas;
+	tune_meas_init(&meas, sim.Ts, pr->Tt, horizon);
+	int stopped = 0;
+	int k, ticks = (int)(horizon / pr->dt + 0.5F);
+	for (k = 0; (k < ticks) && !stopped; k++)
 	{
-		sim_nozzle_cycle(&sim, dt);
-		thermreg_input(&reg, sim.Ts);
-		thermreg_cycle(&reg);
-		thermreg_check(&reg);
-		sim.P = reg.P;
-		printf("%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t, reg.Tc - _0C, reg.P, reg.Pc, reg.P - reg.Pc, reg.Pda, reg.error?1:0);
-		if (reg.error != 0)
-		{
-		}
-		t += dt;
+		sim_nozzle_cycle(&sim, pr->dt);
+		thermreg_input(pr, sim.Ts);
+		thermreg_cycle(pr);
+		thermreg_check(pr);
+		sim.P = pr->P;
+		stopped = tune_meas_sample(&meas, k * pr->dt, sim.Ts);
 	}
+	tune_meas_done(&meas, stopped, pres);
+}
+
+void usage(void)
+{
+	printf("usage: thermtest [-f scenario_file] [-j threads] [-s] [-e] [-l] [-b block] run all scenarios in parallel, print results\n");
+	printf("                                                             (-s = full runs, -e = online C, R estimation, -l = leaky integrator, -b = decimating averager)\n");
+	printf("                                                             (-b 8 and longer blocks miss sensor_260, see thermreg_decim_init)\n");
+	printf("                                                             (-m n = exact plant steps of n regulation periods, also trace, record, sweep)\n");
+	printf("       thermtest [-f scenario_file] trace name [-o file] run one scenario, write binary trace (default name.trc)\n");
+	printf("       thermtest [-f scenario_file] record name [-w pre,post] run one scenario with flight recorder, print window\n");
+	printf("       thermtest [-f scenario_file] rt name [-p period_ms] [-t seconds] [-P prio] [-c cpu] [-o file]\n");
+	printf("                                                             run one scenario in real time (default 10ms period), print jitter\n");
+	printf("                                                             and compute time histograms (-P = SCHED_FIFO priority, -c = pin to cpu)\n");
+	printf("                                                             trace is written by logger thread through telemetry channel (-o)\n");
+	printf("       thermtest [-f scenario_file] [-j threads] mc name [-n runs] [-r seed] [-d noise,adcq,vmax,Taamp,fanr] [-i id [-o file]]\n");
+	printf("                                                             Monte Carlo runs of scenario with disturbances (sensor noise [K], ADC step [K],\n");
+	printf("                                                             random extrussion speed [mm/s], ambient drift [K], R factor with fan on),\n");
+	printf("                                                             print error statistics, -i = reproduce single run (trace to file)\n");
+	printf("       thermtest [-e] [-l] [-b block] net file [-t seconds] [-x] run thermal network with regulator per zone (default 600s),\n");
+	printf("                                                             print zone results (-x = explicit Euler instead of implicit steps)\n");
+	printf("       thermtest [-f scenario_file] sweep [-o file]         sweep check parameters, print detection/false trip table (TSV heat map data to file)\n");
+	printf("       thermtest [-f scenario_file] [-l] [-b block] estcheck run all scenarios with nominal constants and with online estimation,\n");
+	printf("                                                             fail when error detected with nominal constants is missed with -e\n");
+	printf("                                                             or scenario without fault (e.g. plant R drift r@t=factor) trips with -e\n");
+	printf("       thermtest replay [-j threads] [-g] [-o file] log...  replay recorded logs (trace or text t Tc[C] P) through check,\n");
+	printf("                                                             print trips per parameter set and file (-g = sweep grid, -o = TSV)\n");
+	printf("       thermtest tsv file                                    convert binary trace to TSV (t Tc P Pc Pd Pda error)\n");
+	printf("       thermtest bench [zones] [cycles]                      run throughput benchmarks\n");
+	printf("       thermtest soak [days]                                 long-duration drift test of window sums (default 14 days)\n");
+	printf("       thermtest tune [threads]                              autotune kP, kI, ebufl, print best candidates\n");
 }
 
-void test1(void)
+
+int main(int argc, char**argv)
 {
-	float t = 0; // time
-	float dt = 0.01; // delta t
-	float temp = _0C + 250;
-	reg.Tt = temp;
-	while (t < 500)
+	if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
 	{
-		sim_nozzle_cycle(&sim, dt);
-		thermreg_input(&reg, sim.Ts);
-		thermreg_cycle(&reg);
-		thermreg_check(&reg);
-		if (t >= 30)
-			sim.P = 0;
-		else
-			sim.P = reg.P;
-		printf("%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t, reg.Tc - _0C, reg.P, reg.Pc, reg.P - reg.Pc, reg.Pda, reg.error?1:0);
-		if (reg.error != 0)
+		int n = (argc > 2)?atoi(argv[2]):1024;         // number of zones
+		int ncycles = (argc > 3)?atoi(argv[3]):10000;  // number of regulation cycles
+		int ret = bench_thermreg_bank(n, ncycles, 0, 1);
+		ret += bench_thermreg_bank(n, ncycles, 1, 1);
+		ret += bench_thermreg_bank(n, ncycles, 0, 8);
+		ret += bench_thermreg_antiwindup(300);
+		ret += bench_thermreg_decim(ncycles);
+		ret += bench_sim_nozzle_bank(n, ncycles * 0.01F);
+		ret += bench_sim_nozzle_exact(ncycles * 1.0F, 1.0F);
+		ret += bench_disturb(n * ncycles / 10);
+		ret += bench_sim_net(ncycles * 0.1F, 32);
+		return ret?1:0;
+	}
+	if ((argc > 1) && (strcmp(argv[1], "soak") == 0))
+		return bench_thermreg_soak((argc > 2)?atof(argv[2]):14);
+	if ((argc > 1) && (strcmp(argv[1], "tune") == 0))
+	{
+		static const int ebufl[] = {30, 60, 90, 150, 250};
+		static tune_param_t cand[8 * 8 * 5];
+		static tune_result_t res[8 * 8 * 5];
+		int count = tune_grid(cand, 8 * 8 * 5, 10, 120, 8, -5, -160, 8, ebufl, 5);
+		int nthreads = (argc > 2)?atoi(argv[2]):0;
+		unsigned long t0 = time_ms();
+		int best = tune_run(cand, count, tune_eval, 0, res, nthreads);
+		printf("autotune: %d candidates, %lu ms\n", count, time_ms() - t0);
+		tune_print(stdout, cand, res, count, 10);
+		printf("recommended: kP=%.2f kI=%.2f ebufl=%d\n", cand[best].kP, cand[best].kI, cand[best].ebufl);
+		return 0;
+	}
+	if ((argc > 2) && (strcmp(argv[1], "tsv") == 0))
+	{
+		if (trace_to_tsv(argv[2], stdout) < 0)
 		{
+			fprintf(stderr, "cannot read trace file '%s'\n", argv[2]);
+			return 1;
 		}
-		t += dt;
+		return 0;
 	}
-}
 
-void test2(void)
-{
-	float t = 0; // time
-	float dt = 0.01; // delta t
-	float temp = _0C + 250;
-	reg.Tt = temp;
-	while (t < 500)
+	const scenario_t* psc = scenarios;
+	int count = sizeof(scenarios) / sizeof(scenarios[0]);
+	scenario_t* loaded = 0;
+	const char* trace = 0;
+	const char* record = 0;
+	const char* rt = 0;
+	const char* mc = 0;
+	const char* net = 0; // thermal network description file
+	int explicit = 0;    // explicit Euler steps of network (-x)
+	int runs = 1000;  // Monte Carlo runs
+	uint32_t seed = 1; // Monte Carlo seed (first word of generator key)
+	long mcid = -1;   // single Monte Carlo run (-i)
+	const char* dist = "0.3,0.1,5,5,0.7"; // disturbances (-d)
+	rt_config_t rtc = {0.01F, 0, 0, -1}; // real-time run - period, run time (0 = scenario duration), priority, cpu
+	int sweep = 0;
+	int estcheck = 0; // compare results with and without online estimation
+	int replay = 0;  // replay logs (remaining arguments are file names)
+	int grid = 0;    // replay with parameter grid of sweep (-g)
+	const char** files = malloc(argc * sizeof(char*)); // replayed logs
+	int nfiles = 0;
+	const char* output = 0;
+	int pre = 500;   // flight recorder samples before trigger
+	int post = 200;  // flight recorder samples after trigger
+	int nthreads = 0;
+	reg_opts_t opts = {0, 0, 1}; // regulator options
+	int flags = SCENARIO_FAST_FORWARD | SCENARIO_FORK;
+	int i;
+	for (i = 1; i < argc; i++)
 	{
-		sim_nozzle_cycle(&sim, dt);
-		thermreg_input(&reg, sim.Ts);
-		thermreg_cycle(&reg);
-		thermreg_check(&reg);
-		if (t >= 100)
-			sim.P = 0;
+		if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+		{
+			loaded = malloc(MAX_SCENARIOS * sizeof(scenario_t));
+			count = scenario_load(argv[++i], loaded, MAX_SCENARIOS);
+			if (count < 0)
+			{
+				fprintf(stderr, "cannot open scenario file '%s'\n", argv[i]);
+				return 1;
+			}
+			psc = loaded;
+		}
+		else if ((strcmp(argv[i], "-j") == 0) && (i + 1 < argc))
+			nthreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-e") == 0)
+			opts.est = 1;
+		else if (strcmp(argv[i], "-l") == 0)
+			opts.leaky = 1;
+		else if ((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+			opts.pblk = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0)
+			flags &= ~(SCENARIO_FAST_FORWARD | SCENARIO_FORK); // full stepping, separate runs
+		else if ((strcmp(argv[i], "trace") == 0) && (i + 1 < argc))
+			trace = argv[++i];
+		else if ((strcmp(argv[i], "record") == 0) && (i + 1 < argc))
+			record = argv[++i];
+		else if ((strcmp(argv[i], "rt") == 0) && (i + 1 < argc))
+			rt = argv[++i];
+		else if ((strcmp(argv[i], "mc") == 0) && (i + 1 < argc))
+			mc = argv[++i];
+		else if ((strcmp(argv[i], "net") == 0) && (i + 1 < argc))
+			net = argv[++i];
+		else if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc))
+			flags = (flags & (SCENARIO_FAST_FORWARD | SCENARIO_FORK)) | SCENARIO_EXACT(atoi(argv[++i])); // exact plant steps
+		else if (strcmp(argv[i], "-x") == 0)
+			explicit = 1;
+		else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+			runs = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+			seed = strtoul(argv[++i], 0, 0);
+		else if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc))
+			mcid = strtol(argv[++i], 0, 0);
+		else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+			dist = argv[++i];
+		else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+			rtc.period = atof(argv[++i]) * 0.001F;
+		else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+			rtc.seconds = atof(argv[++i]);
+		else if ((strcmp(argv[i], "-P") == 0) && (i + 1 < argc))
+			rtc.prio = atoi(argv[++i]);
+		else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc))
+			rtc.cpu = atoi(argv[++i]);
+		else if (strcmp(argv[i], "replay") == 0)
+			replay = 1;
+		else if (replay && (strcmp(argv[i], "-g") == 0))
+			grid = 1;
+		else if (replay && (argv[i][0] != '-'))
+			files[nfiles++] = argv[i];
+		else if (strcmp(argv[i], "estcheck") == 0)
+			estcheck = 1;
+		else if (strcmp(argv[i], "sweep") == 0)
+			sweep = 1;
+		else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+			output = argv[++i];
+		else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc))
+			sscanf(argv[++i], "%d,%d", &pre, &post);
 		else
-			sim.P = reg.P;
-		printf("%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t, reg.Tc - _0C, reg.P, reg.Pc, reg.P - reg.Pc, reg.Pda, reg.error?1:0);
-		if (reg.error != 0)
 		{
+			usage();
+			return 1;
 		}
-		t += dt;
 	}
-}
 
-void test3(void)
-{
-	float t = 0; // time
-	float dt = 0.01; // delta t
-	float temp = _0C + 250;
-	reg.Tt = temp;
-	while (t < 500)
+	const char* name = trace?trace:(record?record:(rt?rt:mc));
+	if (name)
 	{
-		sim_nozzle_cycle(&sim, dt);
-		if (t >= 100)
-			thermreg_input(&reg, _0C + 240);
-		else
-			thermreg_input(&reg, sim.Ts);
-		thermreg_cycle(&reg);
-		thermreg_check(&reg);
-			sim.P = reg.P;
-		printf("%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t, reg.Tc - _0C, reg.P, reg.Pc, reg.P - reg.Pc, reg.Pda, reg.error?1:0);
-		if (reg.error != 0)
+		for (i = 0; i < count; i++)
+			if (strcmp(psc[i].name, name) == 0)
+				break;
+		if (i == count)
 		{
+			fprintf(stderr, "unknown scenario '%s'\n", name);
+			return 1;
 		}
-		t += dt;
 	}
-}
-
-void test4(void)
-{
-	float t = 0; // time
-	float dt = 0.01; // delta t
-	float temp = _0C + 250;
-	reg.Tt = temp;
-	while (t < 500)
+	if (net)
+	{
+		// thermal network, one regulator per zone (input from sensor tap node, output to power input node)
+		sim_net_t sn;
+		int ret = sim_net_load(&sn, net);
+		if (ret == -1)
+		{
+			fprintf(stderr, "cannot load network file '%s'\n", net);
+			return 1;
+		}
+		if ((ret < 0) || (sn.nz == 0))
+		{
+			fprintf(stderr, "%s: %s\n", net, (ret < 0)?"invalid network":"no zones");
+			sim_net_done(&sn);
+			return 1;
+		}
+		scenario_reg_t* regs = malloc(sn.nz * sizeof(scenario_reg_t));
+		scenario_result_t* res = malloc(sn.nz * sizeof(scenario_result_t));
+		int z;
+		for (z = 0; z < sn.nz; z++)
+		{
+			memset(&regs[z], 0, sizeof(scenario_reg_t));
+			init_zone(&regs[z].reg, &sn.zones[z], &opts);
+			res[z].error = thermreg_error_OK;
+			res[z].terror = -1;
+			res[z].Tpeak = res[z].Tspeak = sn.T[sn.zones[z].sensor] - _0C;
+		}
+		float dt = regs[0].reg.dt;
+		float seconds = (rtc.seconds > 0)?rtc.seconds:600; // -t
+		int k, ticks = (int)(seconds / dt + 0.5F);
+		long iters = 0;
+		unsigned long t0 = time_ms();
+		for (k = 0; k < ticks; k++)
+		{
+			if (explicit)
+				sim_net_cycle(&sn, dt);
+			else
+				iters += sim_net_cycle_implicit(&sn, dt);
+			for (z = 0; z < sn.nz; z++)
+			{
+				const sim_net_zone_t* pz = &sn.zones[z];
+				thermreg_t* pr = &regs[z].reg;
+				thermreg_input(pr, sn.T[pz->sensor]);
+				thermreg_cycle(pr);
+				thermreg_check(pr);
+				sn.P[pz->heater] = pr->P;
+				if ((pr->error != thermreg_error_OK) && (res[z].terror < 0))
+				{
+					res[z].error = pr->error;
+					res[z].terror = k * dt;
+				}
+				if (sn.T[pz->heater] - _0C > res[z].Tpeak) res[z].Tpeak = sn.T[pz->heater] - _0C;
+				if (sn.T[pz->sensor] - _0C > res[z].Tspeak) res[z].Tspeak = sn.T[pz->sensor] - _0C;
+			}
+		}
+		unsigned long ms = time_ms() - t0;
+		printf("net: %d nodes, %d edges, %d zones, %.0f s, %s steps %.0f ms, %lu ms", sn.n, sn.ne, sn.nz, seconds,
+			explicit?"explicit":"implicit", dt * 1000, ms);
+		if (!explicit)
+			printf(" (%.1f iterations/step)", (double)iters / (ticks?ticks:1));
+		printf("\n\n%-16s %-12s %10s %10s %10s %10s\n", "zone", "error", "t_detect", "Th_peak", "Ts_peak", "Ts");
+		for (z = 0; z < sn.nz; z++)
+		{
+			fprintf(stdout, "%-16s %-12s ", sn.zones[z].name, thermreg_error_str(res[z].error));
+			if (res[z].terror >= 0)
+				printf("%10.2f ", res[z].terror);
+			else
+				printf("%10s ", "-");
+			printf("%10.2f %10.2f %10.2f\n", res[z].Tpeak, res[z].Tspeak, sn.T[sn.zones[z].sensor] - _0C);
+		}
+		i = sim_net_find(&sn, "chamber");
+		if (i >= 0)
+			printf("chamber %.2f\n", sn.T[i] - _0C);
+		free(res);
+		free(regs);
+		sim_net_done(&sn);
+	}
+	else if (replay)
+	{
+		// replay logs for base regulator or for each point of check parameter grid
+		int npoints = grid?GRID_POINTS:1;
+		sweep_point_t* pp = 0;
+		if (grid)
+		{
+			pp = malloc(npoints * sizeof(sweep_point_t));
+			npoints = sweep_grid(pp, npoints, grid_ncycl, 3, grid_pbufl, 3, grid_Pdl, 3, grid_C, 3, grid_R, 3);
+		}
+		replay_file_t* pf = malloc(nfiles * sizeof(replay_file_t));
+		replay_result_t* pres = malloc(nfiles * npoints * sizeof(replay_result_t));
+		unsigned long t0 = time_ms();
+		replay_run(files, nfiles, init_regulator, &opts, pp, npoints, pf, pres, nthreads);
+		unsigned long ms = time_ms() - t0;
+		uint64_t rows = 0, bytes = 0;
+		for (i = 0; i < nfiles; i++)
+		{
+			rows += pf[i].rows;
+			bytes += pf[i].bytes;
+		}
+		printf("replay: %d files, %d parameter sets, %llu rows, %.1f MB, %lu ms (%.0f MB/s)\n\n", nfiles, npoints,
+			(unsigned long long)rows, bytes * 1e-6, ms, ms?(bytes * 1e-3 / ms):0);
+		replay_print(stdout, files, nfiles, pp, npoints, pf, pres);
+		if (output && (replay_write_tsv(output, files, nfiles, pp, npoints, pf, pres) < 0))
+			fprintf(stderr, "cannot create file '%s'\n", output);
+		free(pres);
+		free(pf);
+		free(pp);
+	}
+	else if (mc)
 	{
-		sim_nozzle_cycle(&sim, dt);
-		if (t >= 100)
-			thermreg_input(&reg, _0C + 260);
+		// Monte Carlo runs of one scenario with disturbances, run id is second word of generator key
+		disturb_t dcfg;
+		disturb_init(&dcfg, seed, 0);
+		sscanf(dist, "%f,%f,%f,%f,%f", &dcfg.noise, &dcfg.adcq, &dcfg.vmax, &dcfg.Taamp, &dcfg.fanr);
+		printf("mc: '%s' seed %u, noise %.2fK, adc step %.2fK, vex 0..%.1fmm/s, Ta drift %.1fK, fan R x%.2f\n", psc[i].name, seed,
+			dcfg.noise, dcfg.adcq, dcfg.vmax, dcfg.Taamp, dcfg.fanr);
+		if (mcid >= 0)
+		{
+			// single run (same result as in Monte Carlo table), optional trace
+			trace_writer_t tw;
+			scenario_output_t out = {&tw, 0, 0};
+			if (output && (trace_create(&tw, output, 0, 0.01F) < 0))
+			{
+				fprintf(stderr, "cannot create trace file '%s'\n", output);
+				return 1;
+			}
+			scenario_result_t res;
+			scenario_run_disturbed(&psc[i], init_regulator, &opts, &dcfg, (uint32_t)mcid, &res, output?&out:0);
+			if (output && (trace_close(&tw) < 0))
+				fprintf(stderr, "cannot write trace file '%s'\n", output);
+			printf("run %ld\n\n", mcid);
+			scenario_print_header(stdout);
+			scenario_print_result(stdout, &psc[i], &res);
+		}
 		else
-			thermreg_input(&reg, sim.Ts);
-		thermreg_cycle(&reg);
-		thermreg_check(&reg);
-			sim.P = reg.P;
-		printf("%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t, reg.Tc - _0C, reg.P, reg.Pc, reg.P - reg.Pc, reg.Pda, reg.error?1:0);
-		if (reg.error != 0)
 		{
+			scenario_result_t* res = malloc(runs * sizeof(scenario_result_t));
+			unsigned long t0 = time_ms();
+			scenario_run_mc(&psc[i], init_regulator, &opts, &dcfg, 0, runs, res, nthreads);
+			unsigned long ms = time_ms() - t0;
+			printf("%d runs, %lu ms (%.0f simulated s/s)\n\n", runs, ms, ms?(runs * psc[i].duration * 1000 / ms):0);
+			scenario_print_mc(stdout, &psc[i], 0, runs, res);
+			free(res);
+		}
+	}
+	else if (estcheck)
+	{
+		// all scenarios with nominal constants and with online estimation (other options the same)
+		// estimated model may only suppress trips of drifted constants - every fault of nominal run must be detected,
+		// scenario without fault event (sweep_fault_time, e.g. plant R drift) must not trip with estimation
+		scenario_result_t* res = malloc(2 * count * sizeof(scenario_result_t));
+		reg_opts_t eopts = opts;
+		opts.est = 0;
+		eopts.est = 1;
+		scenario_run_all(psc, count, init_regulator, &opts, res, nthreads, flags);
+		scenario_run_all(psc, count, init_regulator, &eopts, res + count, nthreads, flags);
+		int missed = 0;
+		int trips = 0;      // trips of scenarios without fault with estimation
+		int suppressed = 0; // trips of nominal constants without fault suppressed by estimation
+		printf("%-20s %-12s %10s %-12s %10s\n", "scenario", "error", "t_detect", "error_est", "t_detect_est");
+		for (i = 0; i < count; i++)
+		{
+			const scenario_result_t* pn = &res[i];
+			const scenario_result_t* pe = &res[count + i];
+			int fault = sweep_fault_time(&psc[i]) >= 0;
+			int miss = fault && (pn->error != thermreg_error_OK) && (pe->error != pn->error);
+			int trip = !fault && (pe->error != thermreg_error_OK);
+			int supp = !fault && (pn->error != thermreg_error_OK) && !trip;
+			printf("%-20s %-12s %10.2f %-12s %10.2f%s\n", psc[i].name, thermreg_error_str(pn->error), pn->terror,
+				thermreg_error_str(pe->error), pe->terror, miss?"  MISSED":(trip?"  TRIP":(supp?"  suppressed":"")));
+			missed += miss;
+			trips += trip;
+			suppressed += supp;
+		}
+		printf("%d of %d scenarios missed, %d without fault tripped, %d trips of nominal constants suppressed with online estimation\n",
+			missed, count, trips, suppressed);
+		free(res);
+		free(files);
+		free(loaded);
+		return (missed || trips)?1:0;
+	}
+	else if (sweep)
+	{
+		// check parameter grid
+		int npoints = GRID_POINTS;
+		sweep_point_t* pp = malloc(npoints * sizeof(sweep_point_t));
+		sweep_result_t* pres = malloc(npoints * sizeof(sweep_result_t));
+		npoints = sweep_grid(pp, npoints, grid_ncycl, 3, grid_pbufl, 3, grid_Pdl, 3, grid_C, 3, grid_R, 3);
+		sweep_run(psc, count, init_regulator, &opts, pp, npoints, pres, nthreads, flags);
+		sweep_print(stdout, pp, pres, npoints);
+		if (output && (sweep_write_tsv(output, pp, pres, npoints) < 0))
+			fprintf(stderr, "cannot create file '%s'\n", output);
+		free(pres);
+		free(pp);
+	}
+	else if (trace)
+	{
+		// single scenario with full trace output
+		char filename[SCENARIO_MAX_NAME + 8];
+		if (output == 0)
+		{
+			snprintf(filename, sizeof(filename), "%s.trc", psc[i].name);
+			output = filename;
+		}
+		trace_writer_t tw;
+		if (trace_create(&tw, output, 0, 0.01F) < 0)
+		{
+			fprintf(stderr, "cannot create trace file '%s'\n", output);
+			return 1;
+		}
+		scenario_result_t res;
+		scenario_output_t out = {&tw, 0, 0};
+		scenario_run(&psc[i], init_regulator, &opts, &res, &out, flags & ~(SCENARIO_FAST_FORWARD | SCENARIO_FORK));
+		if (trace_close(&tw) < 0)
+			fprintf(stderr, "cannot write trace file '%s'\n", output);
+		scenario_print_header(stdout);
+		scenario_print_result(stdout, &psc[i], &res);
+	}
+	else if (rt)
+	{
+		// single scenario in real time - simulated step stays regulation period, loop period can be changed (-p)
+		static rt_scenario_t rs;
+		static rt_result_t rres;
+		rs.psc = &psc[i];
+		if (scenario_start(&psc[i], init_regulator, &opts, &rs.st) < 0)
+		{
+			fprintf(stderr, "regulator buffers exceed capacity\n");
+			return 1;
+		}
+		if ((rtc.seconds <= 0) || (rtc.seconds > psc[i].duration))
+			rtc.seconds = psc[i].duration;
+		trace_writer_t tw;
+		telem_t telem;
+		if (output)
+		{
+			if (trace_create(&tw, output, 0, 0.01F) < 0)
+			{
+				fprintf(stderr, "cannot create trace file '%s'\n", output);
+				return 1;
+			}
+			if ((telem_init(&telem, 0, &tw) < 0) || (telem_start(&telem) < 0))
+			{
+				fprintf(stderr, "cannot start telemetry logger\n");
+				return 1;
+			}
+			rs.out.telem = &telem;
 		}
-		t += dt;
+		if (rt_run(&rtc, rt_scenario_cycle, &rs, &rres) < 0)
+		{
+			fprintf(stderr, "cannot create real-time thread\n");
+			return 1;
+		}
+		scenario_print_header(stdout);
+		scenario_print_result(stdout, &psc[i], &rs.st.res);
+		rt_print(stdout, &rtc, &rres);
+		if (output)
+		{
+			printf("telemetry: %llu rows, %llu dropped\n", (unsigned long long)telem.pushed, (unsigned long long)telem.drops);
+			telem_done(&telem);
+			if (trace_close(&tw) < 0)
+				fprintf(stderr, "cannot write trace file '%s'\n", output);
+		}
+	}
+	else if (record)
+	{
+		// single scenario with flight recorder, print recorded window
+		static thermrec_sample_t buff[MAX_RECORD];
+		thermrec_t rec;
+		thermrec_init(&rec, 0, buff, MAX_RECORD, pre, post);
+		scenario_result_t res;
+		scenario_output_t out = {0, &rec, 0};
+		scenario_run(&psc[i], init_regulator, &opts, &res, &out, flags & ~(SCENARIO_FAST_FORWARD | SCENARIO_FORK));
+		scenario_print_header(stdout);
+		scenario_print_result(stdout, &psc[i], &res);
+		thermrec_dump(&rec, stdout, 0.01F);
 	}
+	else
+	{
+		// all scenarios in parallel
+		scenario_result_t* res = malloc(count * sizeof(scenario_result_t));
+		scenario_run_all(psc, count, init_regulator, &opts, res, nthreads, flags);
+		scenario_print_header(stdout);
+		for (i = 0; i < count; i++)
+			scenario_print_result(stdout, &psc[i], &res[i]);
+		free(res);
+	}
+	free(files);
+	free(loaded);
+	return 0;
 }
 
 
@@ -182,5 +636,3 @@ unsigned long time_ms(void)
 	gettimeofday(&tv, NULL);
 	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
-
-
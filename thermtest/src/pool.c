@@ -0,0 +1,59 @@
+// pool.c
+
+#include "pool.h"
+#include <pthread.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+
+// maximum number of worker threads
+#define POOL_MAX_THREADS 256
+
+
+typedef struct
+{
+	pool_job_t* job;      // job function
+	void* arg;            // job argument
+	int count;            // number of jobs
+	volatile int next;    // next job index
+} pool_t;
+
+
+int pool_cpus(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	int n = si.dwNumberOfProcessors;
+#else
+	int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (n > 0)?n:1;
+}
+
+static void* pool_worker(void* param)
+{
+	pool_t* pp = (pool_t*)param;
+	int i;
+	while ((i = __sync_fetch_and_add(&pp->next, 1)) < pp->count)
+		pp->job(i, pp->arg);
+	return 0;
+}
+
+void pool_run(int count, pool_job_t* job, void* arg, int nthreads)
+{
+	pool_t pool = {job, arg, count, 0};
+	pthread_t threads[POOL_MAX_THREADS];
+	if (nthreads <= 0) nthreads = pool_cpus();
+	if (nthreads > count) nthreads = count;
+	if (nthreads > POOL_MAX_THREADS) nthreads = POOL_MAX_THREADS;
+	int i, n = 0;
+	for (i = 1; i < nthreads; i++) // first worker is this thread
+		if (pthread_create(&threads[n], 0, pool_worker, &pool) == 0)
+			n++;
+	pool_worker(&pool);
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i], 0);
+}
@@ -0,0 +1,19 @@
+// pool.h
+// simple thread pool - runs indexed jobs on all cpu cores
+
+#ifndef _POOL_H
+#define _POOL_H
+
+
+// job function - called once for each index 0..count-1, from any worker thread
+typedef void (pool_job_t)(int i, void* arg);
+
+// return number of online cpu cores (at least 1)
+extern int pool_cpus(void);
+
+// run 'count' jobs on 'nthreads' worker threads (0 = pool_cpus()) and wait for completion
+// jobs are taken in index order, each worker takes next free index when previous job is done
+extern void pool_run(int count, pool_job_t* job, void* arg, int nthreads);
+
+
+#endif // _POOL_H
@@ -0,0 +1,274 @@
+// replay.c
+
+#include "replay.h"
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+
+
+#define _0C 273.15F
+
+// powers of ten exactly representable in double
+static const double _p10[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+
+// replay job context (shared by all jobs, job index = file index)
+typedef struct
+{
+	const char** files;
+	scenario_init_t* init;
+	void* param;
+	const sweep_point_t* pp;
+	int npoints;
+	replay_file_t* pf;
+	replay_result_t* pres;
+} replay_job_t;
+
+
+// parse decimal number (sign, digits, fraction, exponent) at 'p', returns pointer after number or 0 when there is no number
+// mantissa is accumulated in integer and scaled once (no rounding per digit), digits beyond 18 significant are ignored
+static const char* replay_num(const char* p, const char* end, float* pv)
+{
+	int neg = 0;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+		neg = (*p++ == '-');
+	uint64_t m = 0;  // mantissa
+	int nd = 0;      // number of mantissa digits
+	int exp = 0;     // decimal exponent
+	int digits = 0;  // any digit found
+	for (; (p < end) && (*p >= '0') && (*p <= '9'); p++, digits = 1)
+		if (nd < 18) { m = m * 10 + (*p - '0'); if (m) nd++; }
+		else exp++;
+	if ((p < end) && (*p == '.'))
+		for (p++; (p < end) && (*p >= '0') && (*p <= '9'); p++, digits = 1)
+			if (nd < 18) { m = m * 10 + (*p - '0'); if (m) nd++; exp--; }
+	if (!digits)
+		return 0;
+	if ((p < end) && ((*p == 'e') || (*p == 'E')))
+	{
+		const char* q = p + 1;
+		int eneg = 0;
+		if ((q < end) && ((*q == '-') || (*q == '+')))
+			eneg = (*q++ == '-');
+		if ((q < end) && (*q >= '0') && (*q <= '9'))
+		{
+			int e = 0;
+			for (; (q < end) && (*q >= '0') && (*q <= '9'); q++)
+				if (e < 1000) e = e * 10 + (*q - '0');
+			exp += eneg?-e:e;
+			p = q;
+		}
+	}
+	double v = (double)m;
+	while (exp > 22) { v *= 1e22; exp -= 22; }
+	while (exp < -22) { v /= 1e22; exp += 22; }
+	v = (exp >= 0)?(v * _p10[exp]):(v / _p10[-exp]);
+	*pv = (float)(neg?-v:v);
+	return p;
+}
+
+// replay block of rows through all parameter sets (rows are regulator cycles - input, output power, check)
+static void replay_block(scenario_reg_t* regs, int npoints, replay_result_t* pres, const float* t, const float* Tc, const float* P, int n)
+{
+	int s, r;
+	for (s = 0; s < npoints; s++)
+	{
+		thermreg_t* pr = &regs[s].reg;
+		replay_result_t* ps = &pres[s];
+		for (r = 0; r < n; r++)
+		{
+			thermreg_input(pr, Tc[r]);
+			pr->P = P[r];
+			thermreg_check(pr);
+			if (pr->error != thermreg_error_OK)
+			{
+				if (ps->trips++ == 0)
+				{
+					ps->tfirst = t[r]; // first trip
+					ps->error = pr->error;
+				}
+				thermreg_reset(pr); // continue with empty buffers
+			}
+		}
+	}
+}
+
+// replay text log - parse block of rows, replay block, continue with next block
+static uint64_t replay_text(const char* p, const char* end, scenario_reg_t* regs, int npoints, replay_result_t* pres)
+{
+	float t[REPLAY_BLOCK];  // parsed block (columns)
+	float Tc[REPLAY_BLOCK];
+	float P[REPLAY_BLOCK];
+	uint64_t rows = 0;
+	while (p < end)
+	{
+		int n = 0;
+		while ((p < end) && (n < REPLAY_BLOCK))
+		{
+			float v[3];
+			int k; for (k = 0; k < 3; k++)
+			{
+				while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == ',')))
+					p++;
+				const char* q = replay_num(p, end, &v[k]);
+				if (q == 0)
+					break;
+				p = q;
+			}
+			if (k == 3)
+			{
+				t[n] = v[0];
+				Tc[n] = v[1] + _0C;
+				P[n] = v[2];
+				n++;
+			}
+			while ((p < end) && (*p++ != '\n')); // skip rest of line
+		}
+		replay_block(regs, npoints, pres, t, Tc, P, n);
+		rows += n;
+	}
+	return rows;
+}
+
+// replay binary trace - columns of each block are used directly in mapped memory
+static uint64_t replay_trace(const trace_reader_t* prd, scenario_reg_t* regs, int npoints, replay_result_t* pres)
+{
+	uint32_t b, n;
+	for (b = 0; b < prd->nblocks; b++)
+	{
+		const float* t = trace_column(prd, b, trace_col_t, &n);
+		const float* Tc = trace_column(prd, b, trace_col_Tc, &n);
+		const float* P = trace_column(prd, b, trace_col_P, &n);
+		replay_block(regs, npoints, pres, t, Tc, P, n);
+	}
+	return prd->rows;
+}
+
+static void replay_job(int f, void* arg)
+{
+	replay_job_t* pj = (replay_job_t*)arg;
+	replay_file_t* pf = &pj->pf[f];
+	replay_result_t* pres = &pj->pres[f * pj->npoints];
+	int s;
+	for (s = 0; s < pj->npoints; s++)
+	{
+		pres[s].trips = 0;
+		pres[s].tfirst = -1;
+		pres[s].error = thermreg_error_OK;
+	}
+	memset(pf, 0, sizeof(replay_file_t));
+	// regulators of all parameter sets
+	scenario_reg_t* regs = malloc(pj->npoints * sizeof(scenario_reg_t));
+	if (regs == 0)
+	{
+		pf->status = -3;
+		return;
+	}
+	sim_nozzle_t sim;
+	for (s = 0; s < pj->npoints; s++)
+	{
+		thermreg_t* pr = &regs[s].reg;
+		memset(pr, 0, sizeof(thermreg_t));
+		pj->init(pr, &sim, pj->param);
+		if (pj->pp)
+			sweep_apply(pr, &pj->pp[s]);
+		if ((THERMREG_EBUFN(pr) > SCENARIO_EBUFN) || (pr->pbufl > SCENARIO_PBUFN))
+			pf->status = -2;
+	}
+	trace_reader_t rd;
+	if ((pf->status == 0) && (trace_map(&rd, pj->files[f]) < 0))
+		pf->status = -1;
+	if (pf->status == 0)
+	{
+		pf->bytes = rd.size;
+		if ((rd.size >= 4) && (memcmp(rd.data, "THTR", 4) == 0)) // binary trace - header of the same mapping
+		{
+			if (trace_header(&rd) < 0)
+				pf->status = -1;
+			else
+				pf->rows = replay_trace(&rd, regs, pj->npoints, pres);
+		}
+		else
+			pf->rows = replay_text((const char*)rd.data, (const char*)rd.data + rd.size, regs, pj->npoints, pres);
+		trace_done(&rd);
+	}
+	free(regs);
+}
+
+void replay_run(const char** files, int nfiles, scenario_init_t* init, void* param, const sweep_point_t* pp, int npoints, replay_file_t* pf, replay_result_t* pres, int nthreads)
+{
+	replay_job_t job = {files, init, param, pp, pp?npoints:1, pf, pres};
+	pool_run(nfiles, replay_job, &job, nthreads);
+}
+
+void replay_print(FILE* out, const char** files, int nfiles, const sweep_point_t* pp, int npoints, const replay_file_t* pf, const replay_result_t* pres)
+{
+	if (pp == 0) npoints = 1;
+	int f, s;
+	// per parameter set
+	fprintf(out, "%5s %5s %6s %6s %6s %9s %8s %10s\n", "ncycl", "pbufl", "Pdl", "C", "R", "files", "trips", "t_first");
+	for (s = 0; s < npoints; s++)
+	{
+		int nf = 0, nok = 0, trips = 0;
+		float tfirst = -1;
+		for (f = 0; f < nfiles; f++)
+		{
+			const replay_result_t* pr = &pres[f * npoints + s];
+			if (pf[f].status != 0) continue;
+			nok++;
+			if (pr->trips == 0) continue;
+			nf++;
+			trips += pr->trips;
+			if ((tfirst < 0) || (pr->tfirst < tfirst)) tfirst = pr->tfirst;
+		}
+		if (pp)
+			fprintf(out, "%5d %5d %6.1f %6.2f %6.2f", pp[s].ncycl, pp[s].pbufl, pp[s].Pdl, pp[s].C, pp[s].R);
+		else
+			fprintf(out, "%-33s", "base");
+		fprintf(out, " %4d/%-4d %8d %10.2f\n", nf, nok, trips, tfirst);
+	}
+	// per file
+	fprintf(out, "\n%-32s %10s %9s %10s  %s\n", "file", "rows", "sets", "t_first", "first error");
+	for (f = 0; f < nfiles; f++)
+	{
+		if (pf[f].status != 0)
+		{
+			fprintf(out, "%-32s %s\n", files[f], (pf[f].status == -1)?"cannot open":((pf[f].status == -2)?"regulator buffers exceed capacity":"out of memory"));
+			continue;
+		}
+		int ns = 0;
+		int first = -1; // parameter set with earliest trip
+		for (s = 0; s < npoints; s++)
+		{
+			const replay_result_t* pr = &pres[f * npoints + s];
+			if (pr->trips == 0) continue;
+			ns++;
+			if ((first < 0) || (pr->tfirst < pres[f * npoints + first].tfirst)) first = s;
+		}
+		fprintf(out, "%-32s %10llu %4d/%-4d %10.2f  %s\n", files[f], (unsigned long long)pf[f].rows, ns, npoints,
+			(first >= 0)?pres[f * npoints + first].tfirst:-1, (first >= 0)?thermreg_error_str(pres[f * npoints + first].error):"-");
+	}
+}
+
+int replay_write_tsv(const char* filename, const char** files, int nfiles, const sweep_point_t* pp, int npoints, const replay_file_t* pf, const replay_result_t* pres)
+{
+	if (pp == 0) npoints = 1;
+	FILE* out = fopen(filename, "w");
+	if (out == 0) return -1;
+	fprintf(out, "file\tstatus\trows\tncycl\tpbufl\tPdl\tC\tR\ttrips\tt_first\terror\n");
+	int f, s;
+	for (f = 0; f < nfiles; f++)
+		for (s = 0; s < npoints; s++)
+		{
+			const replay_result_t* pr = &pres[f * npoints + s];
+			fprintf(out, "%s\t%d\t%llu\t", files[f], pf[f].status, (unsigned long long)pf[f].rows);
+			if (pp)
+				fprintf(out, "%d\t%d\t%.2f\t%.3f\t%.3f\t", pp[s].ncycl, pp[s].pbufl, pp[s].Pdl, pp[s].C, pp[s].R);
+			else
+				fprintf(out, "\t\t\t\t\t");
+			fprintf(out, "%d\t%.2f\t%s\n", pr->trips, pr->tfirst, thermreg_error_str(pr->error));
+		}
+	fclose(out);
+	return 0;
+}
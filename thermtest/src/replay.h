@@ -0,0 +1,54 @@
+// replay.h
+// offline replay of recorded printer logs through thermreg_input/thermreg_check - how many real prints would trip
+// with changed check parameters (C, R, Pdnl, Pdpl, pbufl, ncycl), many parameter sets are evaluated in one pass over data
+//
+// log formats (detected by content):
+//   binary trace (trace.h)  columns t, Tc [K], P [W]
+//   text                    one regulator cycle per line "t Tc P ...", Tc in [C], separated by spaces, tabs or commas,
+//                           further columns are ignored, lines not starting with number are skipped (header, '#' comment)
+//                           (TSV output of "thermtest tsv" can be replayed directly)
+// files are memory mapped and parsed without allocation per line, files are processed in parallel (one file per job)
+// log period must be equal to regulation period of base regulator (rows are regulator cycles, t is used only for report)
+
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "scenario.h"
+#include "sweep.h"
+
+// rows parsed from text log and replayed through all parameter sets at once (working set stays in cache)
+#define REPLAY_BLOCK 4096
+
+
+// replay result of one file and one parameter set
+typedef struct
+{
+	int trips;     // number of trips (regulator is reset after each trip and replay continues)
+	float tfirst;  // time of first trip [s] (-1 = no trip)
+	int error;     // first error (thermreg_error_t)
+} replay_result_t;
+
+// replay result of one file
+typedef struct
+{
+	int status;    // 0 = OK, -1 = file cannot be opened, -2 = regulator buffers exceed capacity, -3 = out of memory
+	uint64_t rows; // number of replayed rows
+	uint64_t bytes; // file size [bytes]
+} replay_file_t;
+
+
+// replay 'nfiles' logs on 'nthreads' threads (0 = all cpu cores), regulator of each parameter set is initialized by 'init'
+// and its check parameters are replaced by grid point (sweep_apply), 'pp' = 0 - one parameter set given by 'init' only
+// results of file 'f' and parameter set 's' are stored in pres[f * npoints + s]
+extern void replay_run(const char** files, int nfiles, scenario_init_t* init, void* param, const sweep_point_t* pp, int npoints, replay_file_t* pf, replay_result_t* pres, int nthreads);
+
+// print summary per parameter set (files tripped, trips, earliest first trip) and per file (sets tripped, earliest first trip)
+extern void replay_print(FILE* out, const char** files, int nfiles, const sweep_point_t* pp, int npoints, const replay_file_t* pf, const replay_result_t* pres);
+
+// write all results (TSV, one line per file and parameter set with header), returns 0 on success, -1 on error
+extern int replay_write_tsv(const char* filename, const char** files, int nfiles, const sweep_point_t* pp, int npoints, const replay_file_t* pf, const replay_result_t* pres);
+
+
+#endif // _REPLAY_H
@@ -0,0 +1,199 @@
+// rt.c
+
+#define _GNU_SOURCE
+#include "rt.h"
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+// loop thread context
+typedef struct
+{
+	const rt_config_t* pc; // configuration
+	rt_cycle_t* cycle;     // cycle callback
+	void* arg;             // callback argument
+	rt_result_t* pres;     // result
+} rt_ctx_t;
+
+
+// bucket of value - exact below RT_HIST_SUB, then RT_HIST_SUB buckets per power of two
+static int rt_hist_bucket(uint64_t v)
+{
+	if (v < RT_HIST_SUB)
+		return (int)v;
+	int sh = 63 - __builtin_clzll(v) - RT_HIST_SUBBITS; // shift of sub-bucket
+	return (sh + 1) * RT_HIST_SUB + (int)((v >> sh) - RT_HIST_SUB);
+}
+
+// largest value of bucket
+static uint64_t rt_hist_upper(int b)
+{
+	if (b < RT_HIST_SUB)
+		return b;
+	int sh = b / RT_HIST_SUB - 1;
+	return (((uint64_t)(RT_HIST_SUB + b % RT_HIST_SUB)) << sh) + ((1ULL << sh) - 1);
+}
+
+void rt_hist_init(rt_hist_t* ph)
+{
+	memset(ph, 0, sizeof(rt_hist_t));
+	ph->min = UINT64_MAX;
+}
+
+void rt_hist_add(rt_hist_t* ph, uint64_t v)
+{
+	ph->count[rt_hist_bucket(v)]++;
+	ph->total++;
+	ph->sum += v;
+	if (v < ph->min) ph->min = v;
+	if (v > ph->max) ph->max = v;
+}
+
+uint64_t rt_hist_percentile(const rt_hist_t* ph, double p)
+{
+	if (ph->total == 0)
+		return 0;
+	uint64_t rank = (uint64_t)(p / 100 * ph->total + 0.999999); // number of values at or below percentile
+	if (rank < 1) rank = 1;
+	uint64_t n = 0;
+	int b; for (b = 0; b < RT_HIST_BUCKETS; b++)
+		if ((n += ph->count[b]) >= rank)
+			break;
+	uint64_t v = (b < RT_HIST_BUCKETS)?rt_hist_upper(b):ph->max;
+	return (v > ph->max)?ph->max:v;
+}
+
+
+// monotonic time [ns]
+static uint64_t rt_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// sleep until absolute monotonic time [ns]
+static void rt_sleep_until(uint64_t t)
+{
+	struct timespec ts;
+	ts.tv_sec = t / 1000000000ULL;
+	ts.tv_nsec = t % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR);
+}
+
+// pin calling thread to cpu, returns 1 on success
+static int rt_pin(int cpu)
+{
+#ifdef _WIN32
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return 0;
+#endif
+}
+
+static void* rt_thread(void* param)
+{
+	rt_ctx_t* px = (rt_ctx_t*)param;
+	const rt_config_t* pc = px->pc;
+	rt_result_t* pres = px->pres;
+	if (pc->cpu >= 0)
+		pres->pinned = rt_pin(pc->cpu);
+#ifdef _WIN32
+	if (pc->prio > 0)
+		pres->fifo = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#endif
+	uint64_t period = (uint64_t)(pc->period * 1e9 + 0.5); // period [ns]
+	uint64_t n = (uint64_t)(pc->seconds / pc->period + 0.5); // number of cycles
+	uint64_t next = rt_now() + period; // deadline of wake-up (start of period)
+	uint64_t k; for (k = 0; k < n; k++)
+	{
+		rt_sleep_until(next);
+		uint64_t t0 = rt_now();
+		int stop = px->cycle(px->arg);
+		uint64_t t1 = rt_now();
+		rt_hist_add(&pres->jitter, (t0 > next)?(t0 - next):0);
+		rt_hist_add(&pres->compute, t1 - t0);
+		pres->cycles++;
+		next += period;
+		if (t1 > next) // cycle finished after start of next period
+		{
+			pres->misses++;
+			while (next + period <= t1) // skip periods already over, next cycle starts immediately
+			{
+				next += period;
+				pres->skipped++;
+			}
+		}
+		if (stop)
+			break;
+	}
+	return 0;
+}
+
+int rt_run(const rt_config_t* pc, rt_cycle_t* cycle, void* arg, rt_result_t* pres)
+{
+	rt_ctx_t ctx = {pc, cycle, arg, pres};
+	memset(pres, 0, sizeof(rt_result_t));
+	rt_hist_init(&pres->jitter); // histograms are touched before loop (no page faults in loop)
+	rt_hist_init(&pres->compute);
+	pthread_t thread;
+	int created = 0;
+#ifndef _WIN32
+	if (pc->prio > 0)
+	{
+		mlockall(MCL_CURRENT | MCL_FUTURE); // no paging in loop (ignored without privileges)
+		pthread_attr_t attr;
+		struct sched_param sp;
+		memset(&sp, 0, sizeof(sp));
+		sp.sched_priority = pc->prio;
+		pthread_attr_init(&attr);
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &sp);
+		created = (pthread_create(&thread, &attr, rt_thread, &ctx) == 0);
+		pthread_attr_destroy(&attr);
+		pres->fifo = created;
+	}
+#endif
+	if (!created) // normal scheduling (or SCHED_FIFO not permitted)
+		created = (pthread_create(&thread, 0, rt_thread, &ctx) == 0);
+	if (!created)
+		return -1;
+	pthread_join(thread, 0);
+	return 0;
+}
+
+// print one histogram line [us]
+static void rt_print_hist(FILE* out, const char* name, const rt_hist_t* ph)
+{
+	fprintf(out, "  %-8s %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+		rt_hist_percentile(ph, 50) * 1e-3, rt_hist_percentile(ph, 99) * 1e-3, rt_hist_percentile(ph, 99.9) * 1e-3,
+		ph->max * 1e-3, (ph->total?(ph->sum / ph->total):0) * 1e-3);
+}
+
+void rt_print(FILE* out, const rt_config_t* pc, const rt_result_t* pres)
+{
+	fprintf(out, "rt: period %.2f ms, %llu cycles, %s, %s\n", pc->period * 1000, (unsigned long long)pres->cycles,
+		pres->fifo?"SCHED_FIFO":"normal scheduling", pres->pinned?"pinned":"not pinned");
+	if ((pc->prio > 0) && !pres->fifo)
+		fprintf(out, "  SCHED_FIFO priority %d not permitted\n", pc->prio);
+	if ((pc->cpu >= 0) && !pres->pinned)
+		fprintf(out, "  cannot pin to cpu %d\n", pc->cpu);
+	fprintf(out, "  deadline misses %llu, skipped periods %llu\n", (unsigned long long)pres->misses, (unsigned long long)pres->skipped);
+	fprintf(out, "  [us]            p50        p99      p99.9        max       mean\n");
+	rt_print_hist(out, "jitter", &pres->jitter);
+	rt_print_hist(out, "compute", &pres->compute);
+}
@@ -0,0 +1,73 @@
+// rt.h
+// real-time loop runner (hardware-in-the-loop) - loop is driven by periodic timer with absolute deadlines
+// optionally on SCHED_FIFO thread pinned to one cpu, wake-up jitter and compute time of each cycle are recorded
+// into log-bucketed (HDR style) histograms - fixed size, no allocation in loop
+
+#ifndef _RT_H
+#define _RT_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// histogram resolution - 2^RT_HIST_SUBBITS sub-buckets per power of two (relative error of percentile < 1/16)
+#define RT_HIST_SUBBITS 4
+#define RT_HIST_SUB (1 << RT_HIST_SUBBITS)
+
+// number of histogram buckets - values 0..RT_HIST_SUB-1 exactly, then RT_HIST_SUB buckets for each power of two up to 2^64
+#define RT_HIST_BUCKETS (RT_HIST_SUB * (65 - RT_HIST_SUBBITS))
+
+
+// log-bucketed histogram of durations [ns]
+typedef struct
+{
+	uint64_t count[RT_HIST_BUCKETS]; // counts of buckets
+	uint64_t total;  // number of values
+	uint64_t min;    // minimum value
+	uint64_t max;    // maximum value
+	double sum;      // sum of values (mean = sum / total)
+} rt_hist_t;
+
+// real-time run configuration
+typedef struct
+{
+	float period;  // cycle period [s]
+	float seconds; // run time [s] (number of cycles = seconds / period)
+	int prio;      // SCHED_FIFO priority (0 = normal scheduling)
+	int cpu;       // cpu of loop thread (-1 = not pinned)
+} rt_config_t;
+
+// real-time run result
+typedef struct
+{
+	rt_hist_t jitter;  // wake-up latency - actual wake-up minus deadline [ns]
+	rt_hist_t compute; // compute time of cycle callback [ns]
+	uint64_t cycles;   // number of run cycles
+	uint64_t misses;   // deadline misses - cycle finished after start of next period
+	uint64_t skipped;  // periods skipped after overrun (loop realigned to period grid)
+	int fifo;          // SCHED_FIFO priority was applied
+	int pinned;        // thread was pinned to cpu
+} rt_result_t;
+
+// loop cycle callback (read input, regulation, check, write output), returns nonzero to stop the loop
+typedef int (rt_cycle_t)(void* arg);
+
+
+// clear histogram
+extern void rt_hist_init(rt_hist_t* ph);
+
+// add value [ns] to histogram
+extern void rt_hist_add(rt_hist_t* ph, uint64_t v);
+
+// return percentile 'p' (0-100) - upper bound of bucket (limited to maximum), 0 for empty histogram
+extern uint64_t rt_hist_percentile(const rt_hist_t* ph, double p);
+
+// run loop on new thread, 'cycle' is called at each period until run time elapses or callback returns nonzero
+// when SCHED_FIFO or cpu pinning cannot be applied (e.g. no privileges) loop runs with normal scheduling (see 'fifo', 'pinned')
+// returns 0 on success, -1 when thread cannot be created
+extern int rt_run(const rt_config_t* pc, rt_cycle_t* cycle, void* arg, rt_result_t* pres);
+
+// print summary (cycles, misses, p50/p99/p99.9/max of jitter and compute time in microseconds)
+extern void rt_print(FILE* out, const rt_config_t* pc, const rt_result_t* pres);
+
+
+#endif // _RT_H
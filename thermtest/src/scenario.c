@@ -0,0 +1,589 @@
+// scenario.c
+
+#include "scenario.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "pool.h"
+#include "tsched.h"
+
+
+#define _0C 273.15F
+
+
+// compare ring buffers in logical order (from oldest sample), buffers must have the same length
+static int scenario_ring_equal(const float* pa, int ia, const float* pb, int ib, int len)
+{
+	int i; for (i = 0; i < len; i++)
+		if (pa[(ia + i) % len] != pb[(ib + i) % len])
+			return 0;
+	return 1;
+}
+
+// rotate ring buffer in place so that index 'i' moves to 'i + shift', logical order is kept ('tmp' is work buffer)
+static void scenario_ring_rotate(float* pbuf, float* tmp, int len, int shift)
+{
+	memcpy(tmp, pbuf, len * sizeof(float));
+	int i; for (i = 0; i < len; i++)
+		pbuf[(i + shift) % len] = tmp[i];
+}
+
+// lap sum of ring buffer after index change - values buff[0..i-1] in the same order as thermreg_ring_push adds them
+static float scenario_lap_sum(const float* buff, int i)
+{
+	float s = 0;
+	int j; for (j = 0; j < i; j++)
+		s += buff[j];
+	return s;
+}
+
+// compare closed loop state of current and previous check cycle
+// states are equivalent when all regulator and simulator values and ring buffer contents in logical order are equal
+// (only ring buffer indices and lap sums differ) - closed loop is periodic with period of one check cycle from now
+static int scenario_settled(scenario_reg_t* pa, sim_nozzle_t* psa, scenario_reg_t* pb, sim_nozzle_t* psb)
+{
+	thermreg_t ra = pa->reg;
+	thermreg_t rb = pb->reg;
+	ra.ebufi = rb.ebufi = 0;
+	ra.pbufi = rb.pbufi = 0;
+	ra.ebufn = rb.ebufn = 0;
+	ra.pbufn = rb.pbufn = 0;
+	if (memcmp(&ra, &rb, sizeof(thermreg_t)) != 0) return 0;
+	if ((psa->T != psb->T) || (psa->Th != psb->Th) || (psa->Ts != psb->Ts) || (psa->P != psb->P) || (psa->vex != psb->vex)) return 0;
+	// equal counts - buffers are full (count grows every cycle while buffer is not full)
+	if (!scenario_ring_equal(THERMREG_EBUFF(&pa->reg), pa->reg.ebufi, THERMREG_EBUFF(&pb->reg), pb->reg.ebufi, THERMREG_EBUFN(&pa->reg))) return 0;
+	if (!scenario_ring_equal(THERMREG_PBUFF(&pa->reg), pa->reg.pbufi, THERMREG_PBUFF(&pb->reg), pb->reg.pbufi, pa->reg.pbufl)) return 0;
+	return 1;
+}
+
+// step of event 'ev' of scenario
+static int scenario_event_tick(const scenario_t* psc, int ev, float dt)
+{
+	return (int)(psc->events[ev].t / dt + 0.5F);
+}
+
+// number of steps of scenario
+static int scenario_ticks(const scenario_t* psc, float dt)
+{
+	return (int)(psc->duration / dt + 0.5F);
+}
+
+int scenario_start(const scenario_t* psc, scenario_init_t* init, void* param, scenario_state_t* pst)
+{
+	thermreg_t* pr = &pst->reg.reg;
+	memset(pst, 0, sizeof(scenario_state_t));
+	init(pr, &pst->sim, param);
+	pst->tick = 0;
+	pst->heater = 1;
+	pst->stuck = 0;
+	pst->Tstuck = 0;
+	disturb_init(&pst->dist, 0, 0);
+	pst->res.error = thermreg_error_OK;
+	pst->res.terror = -1;
+	pst->res.Tpeak = pst->sim.T - _0C;
+	pst->res.Tspeak = pst->sim.Ts - _0C;
+	pst->res.ticks_ff = 0;
+	pst->R0 = pst->sim.R;
+	if ((THERMREG_EBUFN(pr) > SCENARIO_EBUFN) || (pr->pbufl > SCENARIO_PBUFN))
+	{
+		fprintf(stderr, "scenario '%s': regulator buffers exceed capacity (%d/%d, %d/%d)\n", psc->name, THERMREG_EBUFN(pr), SCENARIO_EBUFN, pr->pbufl, SCENARIO_PBUFN);
+		return -1;
+	}
+	pr->Tt = psc->Tt + _0C;
+	return 0;
+}
+
+// context of scenario run tasks (scenario_advance)
+typedef struct
+{
+	const scenario_t* psc;
+	scenario_state_t* pst;
+	scenario_output_t* out;
+	sched_t* ps;          // scheduler (tick = simulation step = regulation period)
+	int flags;
+	int dist;             // disturbances enabled
+	int pmul;             // plant step in ticks (0 = Euler step every tick)
+	int end;              // end step
+	int ev;               // index of next event (events before current step are already applied)
+	int evtick;           // tick of next event
+	int checked;          // check cycle done in current tick
+	int nsnap;            // snapshot valid
+	scenario_reg_t snap;  // regulator state of previous check cycle (fast-forward)
+	sim_nozzle_t ssim;    // simulator state of previous check cycle (fast-forward)
+	float sPsum;          // heater power sum of previous check cycle (fast-forward)
+} scenario_ctx_t;
+
+// events - apply events scheduled for this tick
+static void scenario_task_events(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	scenario_state_t* pst = pc->pst;
+	float dt = pc->ps->dt;
+	while ((int)tick >= pc->evtick)
+	{
+		const scenario_event_t* pev = &pc->psc->events[pc->ev];
+		switch (pev->type)
+		{
+		case scenario_event_HEATER: pst->heater = pev->value; break;
+		case scenario_event_SENSOR: pst->stuck = 1; pst->Tstuck = pev->value + _0C; break;
+		case scenario_event_SENSOR_OK: pst->stuck = 0; break;
+		case scenario_event_VEX: sim_nozzle_set_extrussion_speed(&pst->sim, pev->value); break;
+		case scenario_event_TARGET: pst->reg.reg.Tt = pev->value + _0C; break;
+		case scenario_event_R:
+			pst->Rr0 = pc->dist?pst->dist.R0:pst->sim.R;
+			pst->Rr1 = pev->value * pst->R0;
+			pst->rt0 = (int)tick;
+			pst->rt1 = (pc->ev + 1 < pc->psc->nevents)?scenario_event_tick(pc->psc, pc->ev + 1, dt):scenario_ticks(pc->psc, dt);
+			if (pst->rt1 <= pst->rt0) // next event at the same time - step change
+			{
+				if (pc->dist)
+					pst->dist.R0 = pst->Rr1;
+				pst->sim.R = pst->Rr1;
+			}
+			break;
+		}
+		pc->evtick = (++pc->ev < pc->psc->nevents)?scenario_event_tick(pc->psc, pc->ev, dt):pc->end;
+		if (pc->evtick > pc->end) pc->evtick = pc->end;
+		pc->nsnap = 0; // event changes closed loop (heater, sensor) - snapshot not comparable
+	}
+}
+
+// plant - disturbances (ambient temperature, R, extrussion speed) and simulation step
+static void scenario_task_plant(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	scenario_state_t* pst = pc->pst;
+	if ((pst->rt1 > pst->rt0) && ((int)tick <= pst->rt1))
+	{
+		// thermal resistance drift (nominal value of disturbance layer, fan factor is applied on top of it)
+		float R = pst->Rr0 + (pst->Rr1 - pst->Rr0) * ((int)tick - pst->rt0) / (pst->rt1 - pst->rt0);
+		if (pc->dist)
+			pst->dist.R0 = R;
+		pst->sim.R = R;
+	}
+	if (pc->dist)
+		disturb_plant(&pc->pst->dist, &pc->pst->sim, tick);
+	if (pc->pmul)
+	{
+		pc->pst->sim.P = pc->pst->Psum / pc->pmul; // average power of regulation periods since last plant step
+		pc->pst->Psum = 0;
+		sim_nozzle_cycle_exact(&pc->pst->sim, pc->ps->dt * pc->pmul);
+	}
+	else
+		sim_nozzle_cycle(&pc->pst->sim, pc->ps->dt);
+}
+
+// sensor - regulator input (stuck sensor or measured temperature)
+static void scenario_task_sensor(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	scenario_state_t* pst = pc->pst;
+	if (pst->stuck)
+		thermreg_input(&pst->reg.reg, pst->Tstuck);
+	else
+		thermreg_input(&pst->reg.reg, pc->dist?disturb_sensor(&pst->dist, pst->sim.Ts, tick):pst->sim.Ts);
+}
+
+// regulation cycle
+static void scenario_task_regulator(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	(void)tick;
+	thermreg_cycle(&pc->pst->reg.reg);
+}
+
+// power difference check - own period of 'ncycl' regulation periods
+static void scenario_task_check(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	(void)tick;
+	thermreg_check_cycle(&pc->pst->reg.reg);
+	pc->checked = 1;
+}
+
+// heater - apply regulator output to plant
+static void scenario_task_heater(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	(void)tick;
+	pc->pst->sim.P = pc->pst->reg.reg.P * pc->pst->heater;
+	pc->pst->Psum += pc->pst->sim.P;
+}
+
+// outputs - trace row (file or telemetry channel) and flight recorder
+static void scenario_task_output(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	thermreg_t* pr = &pc->pst->reg.reg;
+	sim_nozzle_t* ps = &pc->pst->sim;
+	scenario_output_t* out = pc->out;
+	if (out->trace || out->telem)
+	{
+		trace_sample_t ts = {sched_time(pc->ps, tick), pr->Tc, pr->P, pr->Pc, pr->Pda, pr->error, ps->T, ps->Th, ps->Ts};
+		if (out->telem)
+			telem_push(out->telem, &ts);
+		else
+			trace_write(out->trace, &ts);
+	}
+	if (out->rec)
+		thermrec_cycle(out->rec);
+}
+
+// monitor - first detected error, peaks, fast-forward at end of check cycle
+static void scenario_task_monitor(void* arg, uint32_t tick)
+{
+	scenario_ctx_t* pc = (scenario_ctx_t*)arg;
+	scenario_state_t* pst = pc->pst;
+	thermreg_t* pr = &pst->reg.reg;
+	sim_nozzle_t* ps = &pst->sim;
+	scenario_result_t* pres = &pst->res;
+	int k = (int)tick;
+	if ((pr->error != thermreg_error_OK) && (pres->terror < 0))
+	{
+		pres->error = pr->error;                // first detected error
+		pres->terror = sched_time(pc->ps, tick); // detection time
+	}
+	if (ps->T - _0C > pres->Tpeak) pres->Tpeak = ps->T - _0C;
+	if (ps->Ts - _0C > pres->Tspeak) pres->Tspeak = ps->Ts - _0C;
+	if ((pc->flags & SCENARIO_FAST_FORWARD) && pc->checked && (pr->error == thermreg_error_OK))
+	{
+		// end of check cycle - skip whole check cycles until next event when loop is settled
+		// peaks and error state repeat with period of check cycle, so results are equal to full stepping
+		int m = (pc->evtick - k - 1) / pr->ncycl; // number of check cycles to skip
+		if (pc->nsnap && (m > 0) && (k + 1 < pc->evtick) && (k >= pst->rt1) && (pst->Psum == pc->sPsum) && scenario_settled(&pst->reg, ps, &pc->snap, &pc->ssim))
+		{
+			if (THERMREG_EBUFN(pr))
+			{
+				scenario_ring_rotate(THERMREG_EBUFF(pr), pc->snap.buff, pr->ebufl, (m * pr->ncycl) % pr->ebufl);
+				pr->ebufi = (pr->ebufi + m * pr->ncycl) % pr->ebufl;
+				pr->ebufn = scenario_lap_sum(THERMREG_EBUFF(pr), pr->ebufi);
+			}
+			scenario_ring_rotate(THERMREG_PBUFF(pr), pc->snap.buff, pr->pbufl, m % pr->pbufl);
+			pr->pbufi = (pr->pbufi + m) % pr->pbufl;
+			pr->pbufn = scenario_lap_sum(THERMREG_PBUFF(pr), pr->pbufi);
+			sched_skip(pc->ps, m * pr->ncycl); // all task periods divide check period
+			pres->ticks_ff += m * pr->ncycl;
+			pc->nsnap = 0;
+		}
+		else
+		{
+			memcpy(&pc->snap, &pst->reg, THERMREG_SIZE(THERMREG_EBUFN(pr), pr->pbufl));
+			pc->ssim = *ps;
+			pc->sPsum = pst->Psum;
+			pc->nsnap = 1;
+		}
+	}
+	pc->checked = 0;
+}
+
+void scenario_advance(const scenario_t* psc, scenario_state_t* pst, int end, scenario_output_t* out, int flags)
+{
+	thermreg_t* pr = &pst->reg.reg;
+	sched_t sched;
+	scenario_ctx_t ctx; // task context (on stack - no allocation, scenario_advance can be called for every step)
+	scenario_ctx_t* pc = &ctx;
+	pc->psc = psc;
+	pc->pst = pst;
+	pc->out = out;
+	pc->ps = &sched;
+	pc->checked = 0;
+	pc->nsnap = 0;
+	pc->ssim = pst->sim;
+	if (out && out->rec)
+		out->rec->pr = pr; // attach recorder to this run
+	if (out && (out->trace || out->rec || out->telem))
+		flags &= ~SCENARIO_FAST_FORWARD; // outputs require every step
+	pc->dist = disturb_enabled(&pst->dist);
+	if (pc->dist)
+		flags &= ~SCENARIO_FAST_FORWARD; // disturbed loop is not periodic
+	pc->pmul = SCENARIO_EXACT_PERIOD(flags);
+	if (pc->pmul && (pr->ncycl % pc->pmul))
+		flags &= ~SCENARIO_FAST_FORWARD; // skipped check cycles must be whole plant steps
+	pc->flags = flags;
+	float dt = pr->dt;                        // regulation period (tick), simulation step without SCENARIO_EXACT
+	int ticks = scenario_ticks(psc, dt);      // number of steps
+	if (end > ticks) end = ticks;
+	pc->end = end;
+	pc->ev = 0;
+	while ((pc->ev < psc->nevents) && (scenario_event_tick(psc, pc->ev, dt) < pst->tick)) pc->ev++;
+	pc->evtick = (pc->ev < psc->nevents)?scenario_event_tick(psc, pc->ev, dt):end; // tick of next event
+	if (pc->evtick > end) pc->evtick = end;
+	// tasks - tick is simulation step, check runs at last regulation period of each check cycle (ticks counted from 0)
+	sched_init(&sched, dt);
+	sched.tick = pst->tick; // continue from checkpoint
+	sched_add(&sched, "events", scenario_task_events, pc, 1, 0);
+	sched_add(&sched, "plant", scenario_task_plant, pc, pc->pmul?pc->pmul:1, 0);
+	sched_add(&sched, "sensor", scenario_task_sensor, pc, 1, 0);
+	sched_add(&sched, "regulator", scenario_task_regulator, pc, 1, 0);
+	sched_add(&sched, "check", scenario_task_check, pc, pr->ncycl, pr->ncycl - 1);
+	sched_add(&sched, "heater", scenario_task_heater, pc, 1, 0);
+	if (out && (out->trace || out->rec || out->telem))
+		sched_add(&sched, "output", scenario_task_output, pc, 1, 0);
+	sched_add(&sched, "monitor", scenario_task_monitor, pc, 1, 0);
+	if (end > pst->tick)
+		sched_run(&sched, end - pst->tick);
+	pst->tick = (end > pst->tick)?(int)sched.tick:pst->tick;
+	if (out && out->rec)
+		out->rec->pr = 0; // detach recorder
+}
+
+void scenario_run(const scenario_t* psc, scenario_init_t* init, void* param, scenario_result_t* pres, scenario_output_t* out, int flags)
+{
+	scenario_state_t st;
+	if (scenario_start(psc, init, param, &st) == 0)
+		scenario_advance(psc, &st, INT_MAX, out, flags);
+	*pres = st.res;
+}
+
+void scenario_run_disturbed(const scenario_t* psc, scenario_init_t* init, void* param, const disturb_t* pd, uint32_t id, scenario_result_t* pres, scenario_output_t* out)
+{
+	scenario_state_t st;
+	if (scenario_start(psc, init, param, &st) == 0)
+	{
+		st.dist = *pd;
+		st.dist.key[1] = id;
+		disturb_start(&st.dist, &st.sim, st.reg.reg.dt);
+		scenario_advance(psc, &st, INT_MAX, out, 0);
+	}
+	*pres = st.res;
+}
+
+
+typedef struct
+{
+	const scenario_t* psc;
+	int count;
+	scenario_init_t* init;
+	void* param;
+	scenario_result_t* pres;
+	int flags;
+	scenario_state_t* states; // start state of each scenario (shared prefix)
+	int* fork;                // fork tick of each scenario (first event or end of scenario)
+	int* group;               // first scenario of group with the same target temperature (trunk owner)
+} scenario_job_t;
+
+static void scenario_job(int i, void* arg)
+{
+	scenario_job_t* pj = (scenario_job_t*)arg;
+	scenario_run(&pj->psc[i], pj->init, pj->param, &pj->pres[i], 0, pj->flags);
+}
+
+// trunk of group 'g' - run scenario without events once, store checkpoint at fork tick of each scenario of group
+// fork tick is first event or end of scenario, branches are identical to full run up to this tick
+static void scenario_trunk_job(int g, void* arg)
+{
+	scenario_job_t* pj = (scenario_job_t*)arg;
+	if (pj->group[g] != g) return; // not first scenario of group
+	scenario_t trunk = pj->psc[g];
+	trunk.nevents = 0;
+	scenario_state_t* pst = malloc(sizeof(scenario_state_t));
+	int i;
+	if (scenario_start(&trunk, pj->init, pj->param, pst) < 0)
+	{
+		pst->tick = -1; // capacity exceeded - branches are not run
+		for (i = g; i < pj->count; i++)
+			if (pj->group[i] == g)
+				memcpy(&pj->states[i], pst, sizeof(scenario_state_t));
+		free(pst);
+		return;
+	}
+	float dt = pst->reg.reg.dt;
+	for (i = g; i < pj->count; i++)
+		if (pj->group[i] == g)
+		{
+			const scenario_t* psc = &pj->psc[i];
+			pj->fork[i] = scenario_ticks(psc, dt);
+			if ((psc->nevents > 0) && (scenario_event_tick(psc, 0, dt) < pj->fork[i]))
+				pj->fork[i] = scenario_event_tick(psc, 0, dt);
+			if (pj->fork[i] < 0) pj->fork[i] = 0;
+			if (psc->duration > trunk.duration) trunk.duration = psc->duration; // trunk covers all forks
+		}
+	int last = -1; // last fork tick
+	for (;;)
+	{
+		int next = INT_MAX; // next fork tick
+		for (i = g; i < pj->count; i++)
+			if ((pj->group[i] == g) && (pj->fork[i] > last) && (pj->fork[i] < next))
+				next = pj->fork[i];
+		if (next == INT_MAX) break;
+		scenario_advance(&trunk, pst, next, 0, pj->flags);
+		for (i = g; i < pj->count; i++)
+			if ((pj->group[i] == g) && (pj->fork[i] == next))
+				memcpy(&pj->states[i], pst, sizeof(scenario_state_t)); // checkpoint
+		last = next;
+	}
+	free(pst);
+}
+
+// branch - continue scenario from checkpoint
+static void scenario_branch_job(int i, void* arg)
+{
+	scenario_job_t* pj = (scenario_job_t*)arg;
+	scenario_state_t* pst = &pj->states[i];
+	if (pst->tick >= 0)
+		scenario_advance(&pj->psc[i], pst, INT_MAX, 0, pj->flags);
+	pj->pres[i] = pst->res;
+}
+
+void scenario_run_all(const scenario_t* psc, int count, scenario_init_t* init, void* param, scenario_result_t* pres, int nthreads, int flags)
+{
+	scenario_job_t job = {psc, count, init, param, pres, flags, 0, 0, 0};
+	if (!(flags & SCENARIO_FORK) || (count < 2))
+	{
+		pool_run(count, scenario_job, &job, nthreads);
+		return;
+	}
+	job.states = malloc(count * sizeof(scenario_state_t));
+	job.fork = malloc(count * sizeof(int));
+	job.group = malloc(count * sizeof(int));
+	// scenarios with the same target temperature share prefix until their first event
+	int i, j;
+	for (i = 0; i < count; i++)
+	{
+		for (j = 0; j < i; j++)
+			if (psc[j].Tt == psc[i].Tt)
+				break;
+		job.group[i] = (j < i)?job.group[j]:i;
+	}
+	pool_run(count, scenario_trunk_job, &job, nthreads);  // shared prefixes (one trunk per target temperature)
+	pool_run(count, scenario_branch_job, &job, nthreads); // branches from checkpoints
+	free(job.group);
+	free(job.fork);
+	free(job.states);
+}
+
+
+typedef struct
+{
+	const scenario_t* psc;
+	scenario_init_t* init;
+	void* param;
+	const disturb_t* pd;
+	uint32_t id0;
+	scenario_result_t* pres;
+} scenario_mc_job_t;
+
+static void scenario_mc_job(int i, void* arg)
+{
+	scenario_mc_job_t* pj = (scenario_mc_job_t*)arg;
+	scenario_run_disturbed(pj->psc, pj->init, pj->param, pj->pd, pj->id0 + i, &pj->pres[i], 0);
+}
+
+void scenario_run_mc(const scenario_t* psc, scenario_init_t* init, void* param, const disturb_t* pd, uint32_t id0, int count, scenario_result_t* pres, int nthreads)
+{
+	scenario_mc_job_t job = {psc, init, param, pd, id0, pres};
+	pool_run(count, scenario_mc_job, &job, nthreads);
+}
+
+
+// parse one event token "type@t=value"
+static int scenario_parse_event(const char* tok, scenario_event_t* pev)
+{
+	static const struct { const char* name; int type; } types[] = {
+		{"heater", scenario_event_HEATER},
+		{"sensor", scenario_event_SENSOR},
+		{"sensor_ok", scenario_event_SENSOR_OK},
+		{"vex", scenario_event_VEX},
+		{"target", scenario_event_TARGET},
+		{"r", scenario_event_R},
+	};
+	const char* at = strchr(tok, '@');
+	if (at == 0) return -1;
+	int i; for (i = 0; i < (int)(sizeof(types) / sizeof(types[0])); i++)
+		if ((strlen(types[i].name) == (size_t)(at - tok)) && (strncmp(tok, types[i].name, at - tok) == 0))
+			break;
+	if (i == (int)(sizeof(types) / sizeof(types[0]))) return -1;
+	pev->type = types[i].type;
+	pev->value = 0;
+	char* end;
+	pev->t = strtof(at + 1, &end);
+	if (*end == '=')
+		pev->value = strtof(end + 1, &end);
+	return 0;
+}
+
+int scenario_load(const char* filename, scenario_t* psc, int max)
+{
+	FILE* f = fopen(filename, "r");
+	if (f == 0) return -1;
+	char line[512];
+	int count = 0;
+	while ((count < max) && fgets(line, sizeof(line), f))
+	{
+		char* p = strchr(line, '#');
+		if (p) *p = 0; // remove comment
+		scenario_t* ps = &psc[count];
+		memset(ps, 0, sizeof(scenario_t));
+		char* tok = strtok(line, " \t\r\n");
+		if (tok == 0) continue; // empty line
+		strncpy(ps->name, tok, SCENARIO_MAX_NAME - 1);
+		if ((tok = strtok(0, " \t\r\n")) == 0) continue;
+		ps->Tt = strtof(tok, 0);
+		if ((tok = strtok(0, " \t\r\n")) == 0) continue;
+		ps->duration = strtof(tok, 0);
+		while ((ps->nevents < SCENARIO_MAX_EVENTS) && (tok = strtok(0, " \t\r\n")))
+			if (scenario_parse_event(tok, &ps->events[ps->nevents]) == 0)
+				ps->nevents++;
+			else
+				fprintf(stderr, "%s: invalid event '%s' in scenario '%s'\n", filename, tok, ps->name);
+		int i, j; for (i = 1; i < ps->nevents; i++) // sort events by time
+			for (j = i; (j > 0) && (ps->events[j].t < ps->events[j - 1].t); j--)
+			{
+				scenario_event_t e = ps->events[j];
+				ps->events[j] = ps->events[j - 1];
+				ps->events[j - 1] = e;
+			}
+		count++;
+	}
+	fclose(f);
+	return count;
+}
+
+
+void scenario_print_header(FILE* out)
+{
+	fprintf(out, "%-16s %-12s %10s %10s %10s\n", "scenario", "error", "t_detect", "T_peak", "Ts_peak");
+}
+
+void scenario_print_result(FILE* out, const scenario_t* psc, const scenario_result_t* pres)
+{
+	fprintf(out, "%-16s %-12s ", psc->name, thermreg_error_str(pres->error));
+	if (pres->terror >= 0)
+		fprintf(out, "%10.2f ", pres->terror);
+	else
+		fprintf(out, "%10s ", "-");
+	fprintf(out, "%10.2f %10.2f\n", pres->Tpeak, pres->Tspeak);
+}
+
+void scenario_print_mc(FILE* out, const scenario_t* psc, uint32_t id0, int count, const scenario_result_t* pres)
+{
+	fprintf(out, "%-12s %8s %8s %10s %10s %10s %10s %10s\n", "error", "runs", "%", "t_min", "t_mean", "t_max", "id_min", "id_max");
+	int e;
+	for (e = thermreg_error_OK; e <= thermreg_error_PDPOSLIM; e++)
+	{
+		int n = 0, imin = -1, imax = -1;
+		double sum = 0;
+		int i; for (i = 0; i < count; i++)
+		{
+			if (pres[i].error != e) continue;
+			n++;
+			if (e == thermreg_error_OK) continue;
+			sum += pres[i].terror;
+			if ((imin < 0) || (pres[i].terror < pres[imin].terror)) imin = i;
+			if ((imax < 0) || (pres[i].terror > pres[imax].terror)) imax = i;
+		}
+		if (n == 0) continue;
+		fprintf(out, "%-12s %8d %8.2f ", thermreg_error_str(e), n, 100.0 * n / count);
+		if (imin >= 0)
+			fprintf(out, "%10.2f %10.2f %10.2f %10u %10u\n", pres[imin].terror, sum / n, pres[imax].terror, id0 + imin, id0 + imax);
+		else
+			fprintf(out, "%10s %10s %10s %10s %10s\n", "-", "-", "-", "-", "-");
+	}
+	float Tpeak = -1000, Tspeak = -1000;
+	int i; for (i = 0; i < count; i++)
+	{
+		if (pres[i].Tpeak > Tpeak) Tpeak = pres[i].Tpeak;
+		if (pres[i].Tspeak > Tspeak) Tspeak = pres[i].Tspeak;
+	}
+	fprintf(out, "maximum peaks of '%s': T_peak %.2f, Ts_peak %.2f\n", psc->name, Tpeak, Tspeak);
+}
@@ -0,0 +1,152 @@
+// scenario.h
+// declarative test scenarios (setpoint, duration, fault events) and parallel scenario runner
+
+#ifndef _SCENARIO_H
+#define _SCENARIO_H
+
+#include <stdio.h>
+#include "thermreg.h"
+#include "sim_nozzle.h"
+#include "trace.h"
+#include "thermrec.h"
+#include "telem.h"
+#include "disturb.h"
+
+// maximum number of events in one scenario
+#define SCENARIO_MAX_EVENTS 8
+
+// maximum length of scenario name
+#define SCENARIO_MAX_NAME 32
+
+// buffer capacity of regulators used by scenario runner (error buffer, power difference buffer)
+#define SCENARIO_EBUFN 256
+#define SCENARIO_PBUFN 1024
+
+// scenario run flags
+#define SCENARIO_FAST_FORWARD 1 // skip settled stretches between events (disabled when trace or recorder is used)
+#define SCENARIO_FORK         2 // scenario_run_all - simulate shared prefix (until first event) once, fork branches from checkpoint
+#define SCENARIO_EXACT(n)     ((n) << 8) // plant is stepped by sim_nozzle_cycle_exact every 'n' regulation periods (n * dt step)
+#define SCENARIO_EXACT_PERIOD(flags) ((flags) >> 8) // plant step of flags in regulation periods (0 = Euler step every period)
+
+// regulator type used by scenario runner
+THERMREG_DEFINE(scenario_reg_t, SCENARIO_EBUFN, SCENARIO_PBUFN);
+
+
+// scenario event types
+typedef enum
+{
+	scenario_event_HEATER = 1,  // heater power factor (0 = disconnected heater, 1 = OK)
+	scenario_event_SENSOR = 2,  // sensor stuck at value [C]
+	scenario_event_SENSOR_OK = 3, // sensor restored (value not used)
+	scenario_event_VEX = 4,     // extrussion speed [mm/s]
+	scenario_event_TARGET = 5,  // target temperature [C]
+	scenario_event_R = 6,       // plant thermal resistance drift - R moves linearly to value * initial R until next event or end
+} scenario_event_type_t;
+
+// scenario event
+typedef struct
+{
+	float t;       // event time [s]
+	int type;      // event type (scenario_event_type_t)
+	float value;   // event value
+} scenario_event_t;
+
+// scenario
+typedef struct
+{
+	char name[SCENARIO_MAX_NAME]; // scenario name
+	float Tt;      // target temperature [C]
+	float duration; // simulated time [s]
+	int nevents;   // number of events
+	scenario_event_t events[SCENARIO_MAX_EVENTS]; // events sorted by time
+} scenario_t;
+
+// scenario result
+typedef struct
+{
+	int error;     // first detected error (thermreg_error_t)
+	float terror;  // time of error detection [s] (-1 = no error)
+	float Tpeak;   // peak heat block temperature [C]
+	float Tspeak;  // peak sensor temperature [C]
+	int ticks_ff;  // number of steps skipped by fast-forward
+} scenario_result_t;
+
+// complete state of scenario run (regulator with buffers, simulator, event state, result so far)
+// flat structure without pointers - checkpoint is a plain copy (memcpy), any number of branches can continue from it
+typedef struct
+{
+	scenario_reg_t reg;    // regulator with ring buffers
+	sim_nozzle_t sim;      // simulator
+	int tick;              // next step
+	float heater;          // heater power factor
+	int stuck;             // sensor stuck flag
+	float Tstuck;          // sensor stuck value [K]
+	disturb_t dist;        // disturbances (disabled by scenario_start)
+	float Psum;            // [W] sum of heater power since last plant step (SCENARIO_EXACT)
+	float R0;              // [K/W] plant thermal resistance at start
+	float Rr0, Rr1;        // [K/W] thermal resistance at start and end of drift
+	int rt0, rt1;          // first and end step of drift (rt1 <= rt0 - no drift)
+	scenario_result_t res; // result so far
+} scenario_state_t;
+
+// optional outputs of scenario run (null members are not used)
+typedef struct
+{
+	trace_writer_t* trace; // full trace, one row per step
+	thermrec_t* rec;       // flight recorder (attached to regulator of the run)
+	telem_t* telem;        // telemetry channel - rows are pushed to logger thread instead of written by run (no I/O in loop)
+} scenario_output_t;
+
+// initialization callback - initialize regulator and simulator for one scenario run
+// regulator buffers must fit into SCENARIO_EBUFN and SCENARIO_PBUFN
+typedef void (scenario_init_t)(thermreg_t* pr, sim_nozzle_t* ps, void* param);
+
+
+// run one scenario, regulator period 'dt' is used also as simulation step
+// 'out' can be null when no output is required, 'flags' - SCENARIO_FAST_FORWARD or 0 (full stepping)
+// with SCENARIO_EXACT(n) plant takes one exact step of n * dt with average heater power of last n regulation periods (heater
+// energy is kept), regulator sees the same sensor temperature for n periods (fast-forward requires n to divide check period)
+// fast-forward is disabled when disturbances are enabled (closed loop is not periodic)
+// fast-forward: when regulator and simulator state at the end of check cycle equals state of previous check cycle
+// (ring buffers compared in logical order), closed loop is periodic and whole check cycles are skipped until next event
+// results (error, detection time, peaks) are identical to full stepping
+extern void scenario_run(const scenario_t* psc, scenario_init_t* init, void* param, scenario_result_t* pres, scenario_output_t* out, int flags);
+
+// initialize state of scenario run at time 0 (regulator, simulator, target temperature)
+// returns 0 on success, -1 when regulator buffers exceed capacity
+extern int scenario_start(const scenario_t* psc, scenario_init_t* init, void* param, scenario_state_t* pst);
+
+// continue scenario run from state 'pst' (e.g. restored checkpoint) until step 'end' (INT_MAX = end of scenario)
+// events scheduled before current step are considered applied, 'out' and 'flags' as for scenario_run
+extern void scenario_advance(const scenario_t* psc, scenario_state_t* pst, int end, scenario_output_t* out, int flags);
+
+// run 'count' scenarios in parallel on 'nthreads' threads (0 = all cpu cores), each worker uses its own regulator and simulator
+// with SCENARIO_FORK scenarios with the same target temperature share one trunk run until their first event (checkpoint),
+// branches continue from checkpoints in parallel, results are identical to separate runs
+extern void scenario_run_all(const scenario_t* psc, int count, scenario_init_t* init, void* param, scenario_result_t* pres, int nthreads, int flags);
+
+// run one scenario with disturbances - configuration 'pd' (disturb_init, seed is first word of key), 'id' is run id
+// (second word of key), each run depends only on seed and id - any run of Monte Carlo is reproduced exactly in isolation
+// 'out' can be null when no output is required
+extern void scenario_run_disturbed(const scenario_t* psc, scenario_init_t* init, void* param, const disturb_t* pd, uint32_t id, scenario_result_t* pres, scenario_output_t* out);
+
+// Monte Carlo - 'count' disturbed runs of scenario with run ids id0..id0+count-1 in parallel on 'nthreads' threads
+// (0 = all cpu cores), result of run id0+i is stored in pres[i]
+extern void scenario_run_mc(const scenario_t* psc, scenario_init_t* init, void* param, const disturb_t* pd, uint32_t id0, int count, scenario_result_t* pres, int nthreads);
+
+// load scenario table from text file, returns number of loaded scenarios or -1 when file cannot be opened
+// line format: name Tt[C] duration[s] [event@t=value ...]
+// events: heater@t=factor, sensor@t=value[C], sensor_ok@t, vex@t=speed[mm/s], target@t=value[C], r@t=factor (plant R
+// drifts to factor * initial R until next event or end); '#' starts comment
+extern int scenario_load(const char* filename, scenario_t* psc, int max);
+
+// print result table header and one result line
+extern void scenario_print_header(FILE* out);
+extern void scenario_print_result(FILE* out, const scenario_t* psc, const scenario_result_t* pres);
+
+// print Monte Carlo summary of 'count' runs with ids id0..id0+count-1 - runs per detected error, detection time
+// min/mean/max with ids of runs of first and last detection (reproduce with scenario_run_disturbed), maximum peaks
+extern void scenario_print_mc(FILE* out, const scenario_t* psc, uint32_t id0, int count, const scenario_result_t* pres);
+
+
+#endif // _SCENARIO_H
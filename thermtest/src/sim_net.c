@@ -0,0 +1,335 @@
+// sim_net.c
+
+#include "sim_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+#define _0C 273.15F
+
+// relative residual of conjugate gradient (norm of residual / norm of right side)
+#define _CG_TOL 1e-10
+
+// maximum line length of description file
+#define _LINE 256
+
+
+int sim_net_init(sim_net_t* pn, int nmax, int emax)
+{
+	memset(pn, 0, sizeof(sim_net_t));
+	// one block - doubles first (alignment), then floats, ints and names
+	size_t size = (size_t)(6 * nmax + emax) * sizeof(double)
+		+ (size_t)(4 * nmax + 2 * emax) * sizeof(float)
+		+ (size_t)(2 * (nmax + 1) + 4 * emax) * sizeof(int)
+		+ (size_t)nmax * SIM_NET_MAX_NAME;
+	void* mem = malloc(size);
+	if (mem == 0)
+		return -1;
+	memset(mem, 0, size);
+	pn->mem = mem;
+	pn->nmax = nmax;
+	pn->emax = emax;
+	// distribute memory block
+	double* d = mem;
+	pn->dx = d; d += nmax;
+	pn->r = d; d += nmax;
+	pn->z = d; d += nmax;
+	pn->p = d; d += nmax;
+	pn->q = d; d += nmax;
+	pn->dg = d; d += nmax;
+	pn->Fd = d; d += emax;
+	float* f = (float*)d;
+	pn->C = f; f += nmax;
+	pn->T = f; f += nmax;
+	pn->P = f; f += nmax;
+	pn->L = f; f += nmax;
+	pn->R = f; f += emax;
+	pn->F = f; f += emax;
+	int* i = (int*)f;
+	pn->ea = i; i += emax;
+	pn->eb = i; i += emax;
+	pn->oi = i; i += nmax + 1;
+	pn->oe = i; i += emax;
+	pn->ii = i; i += nmax + 1;
+	pn->ie = i; i += emax;
+	pn->name = (char (*)[SIM_NET_MAX_NAME])i;
+	return 0;
+}
+
+void sim_net_done(sim_net_t* pn)
+{
+	if (pn->mem)
+		free(pn->mem);
+	pn->mem = 0;
+}
+
+int sim_net_node(sim_net_t* pn, const char* name, float C, float T)
+{
+	if (pn->n >= pn->nmax)
+		return -1;
+	int i = pn->n++;
+	strncpy(pn->name[i], name, SIM_NET_MAX_NAME - 1);
+	pn->name[i][SIM_NET_MAX_NAME - 1] = 0;
+	pn->C[i] = C;
+	pn->T[i] = T;
+	pn->P[i] = 0;
+	pn->L[i] = 0;
+	return i;
+}
+
+int sim_net_edge(sim_net_t* pn, int a, int b, float R)
+{
+	if ((pn->ne >= pn->emax) || (a < 0) || (a >= pn->n) || (b < 0) || (b >= pn->n) || (a == b))
+		return -1;
+	int e = pn->ne++;
+	pn->ea[e] = a;
+	pn->eb[e] = b;
+	pn->R[e] = R;
+	return e;
+}
+
+// build one incidence list in CSR form - edges with node 'nodes[e]', ascending edge order within node (counting sort)
+static void sim_net_csr(int n, int ne, const int* nodes, int* idx, int* list)
+{
+	int i, e;
+	memset(idx, 0, (n + 1) * sizeof(int));
+	for (e = 0; e < ne; e++)
+		idx[nodes[e] + 1]++;
+	for (i = 0; i < n; i++)
+		idx[i + 1] += idx[i];
+	for (e = 0; e < ne; e++)
+		list[idx[nodes[e]]++] = e;
+	for (i = n; i > 0; i--) // restore start indices (shifted by fill)
+		idx[i] = idx[i - 1];
+	idx[0] = 0;
+}
+
+void sim_net_build(sim_net_t* pn)
+{
+	sim_net_csr(pn->n, pn->ne, pn->ea, pn->oi, pn->oe);
+	sim_net_csr(pn->n, pn->ne, pn->eb, pn->ii, pn->ie);
+}
+
+int sim_net_find(const sim_net_t* pn, const char* name)
+{
+	int i; for (i = 0; i < pn->n; i++)
+		if (strcmp(pn->name[i], name) == 0)
+			return i;
+	return -1;
+}
+
+// parse one line of description file (after comment removal), returns 0 on success or empty line, -1 on error
+static int sim_net_parse(sim_net_t* pn, char* line)
+{
+	char* tok[8];
+	int nt = 0;
+	char* t = strtok(line, " \t\r\n");
+	while (t && (nt < 8))
+	{
+		tok[nt++] = t;
+		t = strtok(0, " \t\r\n");
+	}
+	if (nt == 0)
+		return 0; // empty line
+	if ((strcmp(tok[0], "node") == 0) && (nt == 4))
+		return (sim_net_node(pn, tok[1], strtof(tok[2], 0), strtof(tok[3], 0) + _0C) < 0)?-1:0;
+	if ((strcmp(tok[0], "edge") == 0) && (nt == 4))
+		return (sim_net_edge(pn, sim_net_find(pn, tok[1]), sim_net_find(pn, tok[2]), strtof(tok[3], 0)) < 0)?-1:0;
+	if ((strcmp(tok[0], "zone") == 0) && (nt == 8) && (pn->nz < SIM_NET_MAX_ZONES))
+	{
+		sim_net_zone_t* pz = &pn->zones[pn->nz];
+		memset(pz, 0, sizeof(sim_net_zone_t));
+		strncpy(pz->name, tok[1], SIM_NET_MAX_NAME - 1);
+		pz->heater = sim_net_find(pn, tok[2]);
+		pz->sensor = sim_net_find(pn, tok[3]);
+		pz->Tt = strtof(tok[4], 0);
+		pz->Pmax = strtof(tok[5], 0);
+		pz->C = strtof(tok[6], 0);
+		pz->R = strtof(tok[7], 0);
+		if ((pz->heater < 0) || (pz->sensor < 0))
+			return -1;
+		pn->nz++;
+		return 0;
+	}
+	return -1;
+}
+
+int sim_net_load(sim_net_t* pn, const char* filename)
+{
+	memset(pn, 0, sizeof(sim_net_t));
+	FILE* f = fopen(filename, "r");
+	if (f == 0)
+		return -1;
+	char line[_LINE];
+	int nmax = 0, emax = 0;
+	while (fgets(line, sizeof(line), f)) // first pass - capacity
+	{
+		char* p = line;
+		while ((*p == ' ') || (*p == '\t')) p++;
+		if (strncmp(p, "node", 4) == 0) nmax++;
+		if (strncmp(p, "edge", 4) == 0) emax++;
+	}
+	if (sim_net_init(pn, nmax, emax) < 0)
+	{
+		fclose(f);
+		return -1;
+	}
+	rewind(f);
+	int ln = 0, ret = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		ln++;
+		char* p = strchr(line, '#');
+		if (p) *p = 0; // remove comment
+		if (sim_net_parse(pn, line) < 0)
+		{
+			fprintf(stderr, "%s:%d: invalid line\n", filename, ln);
+			ret = -2;
+		}
+	}
+	fclose(f);
+	sim_net_build(pn);
+	return ret;
+}
+
+int sim_net_nozzle(sim_net_t* pn, const sim_nozzle_t* ps)
+{
+	if (sim_net_init(pn, 4, 3) < 0)
+		return -1;
+	sim_net_node(pn, "heater", ps->Ch, ps->Th);
+	sim_net_node(pn, "block", ps->C, ps->T);
+	sim_net_node(pn, "sensor", ps->Cs, ps->Ts);
+	sim_net_node(pn, "ambient", 0, ps->Ta);
+	// edge order gives the same order of sums as sim_nozzle_cycle - block: Ph - (Pl + Ps)
+	sim_net_edge(pn, sim_net_nozzle_HEATER, sim_net_nozzle_BLOCK, ps->Rh);
+	sim_net_edge(pn, sim_net_nozzle_BLOCK, sim_net_nozzle_AMBIENT, ps->R);
+	sim_net_edge(pn, sim_net_nozzle_BLOCK, sim_net_nozzle_SENSOR, ps->Rs);
+	sim_net_build(pn);
+	sim_net_nozzle_inputs(pn, ps);
+	return 0;
+}
+
+void sim_net_nozzle_inputs(sim_net_t* pn, const sim_nozzle_t* ps)
+{
+	pn->C[sim_net_nozzle_HEATER] = ps->Ch;
+	pn->C[sim_net_nozzle_BLOCK] = ps->C;
+	pn->C[sim_net_nozzle_SENSOR] = ps->Cs;
+	pn->R[0] = ps->Rh;
+	pn->R[1] = ps->R;
+	pn->R[2] = ps->Rs;
+	pn->P[sim_net_nozzle_HEATER] = ps->P;
+	pn->L[sim_net_nozzle_BLOCK] = ps->Ex * ps->vex; //[W] extrussion power
+	pn->T[sim_net_nozzle_AMBIENT] = ps->Ta;
+}
+
+void sim_net_cycle(sim_net_t* pn, float dt)
+{
+	int e, i, k;
+	for (e = 0; e < pn->ne; e++) //[W] edge flows from current temperatures
+		pn->F[e] = (pn->T[pn->ea[e]] - pn->T[pn->eb[e]]) / pn->R[e];
+	for (i = 0; i < pn->n; i++)
+	{
+		if (pn->C[i] == 0) continue; // boundary node
+		float in = pn->P[i]; //[W] heater power and inflows
+		for (k = pn->ii[i]; k < pn->ii[i + 1]; k++)
+			in += pn->F[pn->ie[k]];
+		float out = 0;       //[W] outflows
+		for (k = pn->oi[i]; k < pn->oi[i + 1]; k++)
+			out += pn->F[pn->oe[k]];
+		float E = pn->C[i] * pn->T[i]; //[J] heat energy stored in node
+		float Ed = (in - out) * dt;    //[J] energy increase
+		Ed -= pn->L[i] * dt;
+		E += Ed;
+		pn->T[i] = E / pn->C[i];
+	}
+}
+
+// q = A * p, A = C / dt + Laplacian of free nodes (p of boundary nodes is zero)
+static void sim_net_matvec(sim_net_t* pn, double idt, const double* p, double* q)
+{
+	int e, i, k;
+	for (e = 0; e < pn->ne; e++)
+		pn->Fd[e] = (p[pn->ea[e]] - p[pn->eb[e]]) / pn->R[e];
+	for (i = 0; i < pn->n; i++)
+	{
+		double s = pn->C[i] * idt * p[i];
+		for (k = pn->oi[i]; k < pn->oi[i + 1]; k++)
+			s += pn->Fd[pn->oe[k]];
+		for (k = pn->ii[i]; k < pn->ii[i + 1]; k++)
+			s -= pn->Fd[pn->ie[k]];
+		q[i] = (pn->C[i] == 0)?0:s;
+	}
+}
+
+static double sim_net_dot(const double* a, const double* b, int n)
+{
+	double s = 0;
+	int i; for (i = 0; i < n; i++)
+		s += a[i] * b[i];
+	return s;
+}
+
+int sim_net_cycle_implicit(sim_net_t* pn, float dt)
+{
+	// (C / dt + Laplacian) * dx = P - L + inflows - outflows at current temperatures
+	int n = pn->n;
+	double idt = 1.0 / dt;
+	int e, i, k;
+	for (e = 0; e < pn->ne; e++)
+		pn->Fd[e] = ((double)pn->T[pn->ea[e]] - pn->T[pn->eb[e]]) / pn->R[e];
+	for (i = 0; i < n; i++)
+	{
+		pn->dx[i] = 0;
+		if (pn->C[i] == 0) // boundary node - fixed temperature
+		{
+			pn->r[i] = 0;
+			pn->dg[i] = 1;
+			continue;
+		}
+		double b = (double)pn->P[i] - pn->L[i];
+		double g = pn->C[i] * idt;
+		for (k = pn->ii[i]; k < pn->ii[i + 1]; k++)
+		{
+			b += pn->Fd[pn->ie[k]];
+			g += 1.0 / pn->R[pn->ie[k]];
+		}
+		for (k = pn->oi[i]; k < pn->oi[i + 1]; k++)
+		{
+			b -= pn->Fd[pn->oe[k]];
+			g += 1.0 / pn->R[pn->oe[k]];
+		}
+		pn->r[i] = b;
+		pn->dg[i] = g;
+	}
+	// preconditioned conjugate gradient, start dx = 0
+	double bb = sim_net_dot(pn->r, pn->r, n);
+	for (i = 0; i < n; i++)
+		pn->p[i] = pn->z[i] = pn->r[i] / pn->dg[i];
+	double rz = sim_net_dot(pn->r, pn->z, n);
+	int it;
+	for (it = 0; it < 2 * n + 10; it++)
+	{
+		if (sim_net_dot(pn->r, pn->r, n) <= _CG_TOL * _CG_TOL * bb)
+			break;
+		sim_net_matvec(pn, idt, pn->p, pn->q);
+		double alpha = rz / sim_net_dot(pn->p, pn->q, n);
+		for (i = 0; i < n; i++)
+		{
+			pn->dx[i] += alpha * pn->p[i];
+			pn->r[i] -= alpha * pn->q[i];
+			pn->z[i] = pn->r[i] / pn->dg[i];
+		}
+		double rzn = sim_net_dot(pn->r, pn->z, n);
+		double beta = rzn / rz;
+		rz = rzn;
+		for (i = 0; i < n; i++)
+			pn->p[i] = pn->z[i] + beta * pn->p[i];
+	}
+	for (i = 0; i < n; i++)
+		if (pn->C[i] != 0)
+			pn->T[i] += (float)pn->dx[i];
+	pn->iters = it;
+	return it;
+}
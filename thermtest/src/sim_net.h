@@ -0,0 +1,133 @@
+// sim_net.h
+// thermal network simulator - N nodes (heat capacities) connected by edges (thermal resistances), power inputs and loads
+// per node, boundary nodes with fixed temperature (ambient), zones pair power input node and sensor tap node for regulator
+// heated beds with several heaters and sensors, chambers, several hotends coupled through shared ambient
+//
+// layout: nodes and edges in structure-of-arrays, incidence lists of each node in CSR form (edge indices in ascending order)
+// step: edge flows in one pass over edges, node balances in one pass over nodes (no scatter)
+// integrators:
+//   sim_net_cycle           explicit Euler in heat energy - same operations in the same order as sim_nozzle_cycle,
+//                           network of sim_net_nozzle reproduces sim_nozzle_cycle bit exactly
+//   sim_net_cycle_implicit  backward Euler - linear system (C / dt + Laplacian) * dT = power balance is solved by conjugate
+//                           gradient with Jacobi preconditioner (matrix free, same edge/node passes), unconditionally stable,
+//                           stiff small nodes (sensor beads, heater cores) do not limit 'dt'
+//
+// description file format (one item per line, '#' starts comment, nodes must be declared before use):
+//   node name C[J/K] T0[C]                             node, C = 0 - boundary node with fixed temperature T0 (ambient)
+//   edge node1 node2 R[K/W]                            thermal resistance between nodes
+//   zone name heater sensor Tt[C] Pmax[W] C[J/K] R[K/W] regulated zone - power input node, sensor tap node, target,
+//                                                      maximum power, model constants of power check
+
+#ifndef _SIM_NET_H
+#define _SIM_NET_H
+
+#include <inttypes.h>
+#include "sim_nozzle.h"
+
+// maximum length of node and zone name
+#define SIM_NET_MAX_NAME 16
+
+// maximum number of zones
+#define SIM_NET_MAX_ZONES 16
+
+
+// node indices of network built by sim_net_nozzle
+typedef enum
+{
+	sim_net_nozzle_HEATER = 0,
+	sim_net_nozzle_BLOCK = 1,
+	sim_net_nozzle_SENSOR = 2,
+	sim_net_nozzle_AMBIENT = 3,
+} sim_net_nozzle_node_t;
+
+// regulated zone (description only, simulator does not use zones)
+typedef struct
+{
+	char name[SIM_NET_MAX_NAME];
+	int heater;    // power input node
+	int sensor;    // sensor tap node
+	float Tt;      // target temperature [C]
+	float Pmax;    // maximum heater power [W]
+	float C;       // model heat capacity of power check [J/K]
+	float R;       // model thermal resistance of power check [K/W]
+} sim_net_zone_t;
+
+// thermal network
+typedef struct
+{
+	int n;         // number of nodes
+	int ne;        // number of edges
+	int nmax;      // node capacity
+	int emax;      // edge capacity
+	// nodes - parameters, inputs and state (changes take effect in next step)
+	float* C;      // [J/K] heat capacity (0 = boundary node, temperature is input)
+	float* T;      // [K] temperature
+	float* P;      // [W] power input (heater)
+	float* L;      // [W] power load (extrussion), subtracted after balance of flows
+	char (*name)[SIM_NET_MAX_NAME]; // node names
+	// edges - topology and parameters (R can be changed at any time, topology changes require sim_net_build)
+	int* ea;       // first node (flow is positive from ea to eb)
+	int* eb;       // second node
+	float* R;      // [K/W] thermal resistance
+	// incidence lists (sim_net_build)
+	int* oi;       // out edges of node i are oe[oi[i]..oi[i+1]-1] (node is ea)
+	int* oe;
+	int* ii;       // in edges of node i are ie[ii[i]..ii[i+1]-1] (node is eb)
+	int* ie;
+	// work arrays
+	float* F;      // [W] edge flows (explicit step)
+	double* Fd;    // edge flows of search direction (implicit step)
+	double* dx;    // temperature increment (implicit step)
+	double* r;     // residual
+	double* z;     // preconditioned residual
+	double* p;     // search direction
+	double* q;     // matrix times search direction
+	double* dg;    // diagonal of matrix (preconditioner)
+	int iters;     // conjugate gradient iterations of last implicit step
+	// zones
+	int nz;        // number of zones
+	sim_net_zone_t zones[SIM_NET_MAX_ZONES];
+	void* mem;     // allocated memory block
+} sim_net_t;
+
+
+// allocate empty network with capacity 'nmax' nodes and 'emax' edges
+// returns 0 on success, -1 when allocation fails
+extern int sim_net_init(sim_net_t* pn, int nmax, int emax);
+
+// free allocated memory
+extern void sim_net_done(sim_net_t* pn);
+
+// add node with heat capacity 'C' [J/K] (0 = boundary node) and temperature 'T' [K], returns node index or -1 (full)
+extern int sim_net_node(sim_net_t* pn, const char* name, float C, float T);
+
+// add edge with thermal resistance 'R' [K/W] between nodes 'a' and 'b', returns edge index or -1 (full, invalid node)
+extern int sim_net_edge(sim_net_t* pn, int a, int b, float R);
+
+// build incidence lists - call after nodes and edges are added (before first step)
+extern void sim_net_build(sim_net_t* pn);
+
+// find node by name, returns node index or -1
+extern int sim_net_find(const sim_net_t* pn, const char* name);
+
+// load network from description file (allocated by this function, sim_net_done frees it)
+// returns 0 on success, -1 when file cannot be opened or memory allocated, -2 on invalid line (reported to stderr)
+extern int sim_net_load(sim_net_t* pn, const char* filename);
+
+// build network equal to nozzle model 'ps' - nodes heater, block, sensor, ambient (boundary), edges in order
+// heater-block, block-ambient, block-sensor; extrussion power Ex * vex is load of block (set by sim_net_nozzle_inputs)
+// returns 0 on success, -1 when allocation fails
+extern int sim_net_nozzle(sim_net_t* pn, const sim_nozzle_t* ps);
+
+// copy parameters and inputs of nozzle model (capacities, resistances, heater power, extrussion load, ambient temperature)
+// to network of sim_net_nozzle, state (temperatures of nodes) is not changed
+extern void sim_net_nozzle_inputs(sim_net_t* pn, const sim_nozzle_t* ps);
+
+// explicit Euler step 'dt' (stable only when 'dt' is shorter than smallest node time constant C / sum of 1/R of its edges)
+extern void sim_net_cycle(sim_net_t* pn, float dt);
+
+// backward Euler step 'dt' (unconditionally stable), returns number of conjugate gradient iterations
+extern int sim_net_cycle_implicit(sim_net_t* pn, float dt);
+
+
+#endif // _SIM_NET_H
@@ -1,5 +1,13 @@
 
 #include "sim_nozzle.h"
+#include <math.h>
+#include <string.h>
+
+// dimension of augmented matrix [A B; 0 0] - 3 states, 2 inputs
+#define _XN 5
+
+// number of Taylor series terms of scaled matrix exponential
+#define _XTERMS 12
 
 
 void sim_nozzle_init(sim_nozzle_t* ps)
@@ -17,6 +25,7 @@ void sim_nozzle_init(sim_nozzle_t* ps)
 	ps->P = 0;      //[W] heater power
 	ps->Ex = 0.2;   //[J/mm] extrussion energy factor
 	ps->vex = 0;    //[mm/s] extrussion speed
+	ps->xd.dt = 0;  // exact discretization not calculated
 }
 
 void sim_nozzle_set_extrussion_speed(sim_nozzle_t* ps, float vex)
@@ -53,3 +62,106 @@ void sim_nozzle_cycle(sim_nozzle_t* ps, float dt)
 //	noise_temp = (((float)rand() / RAND_MAX) - 0.5F) * 2.0F;
 //	temp += noise_temp;
 }
+
+// matrix product c = a * b (c must not be a or b)
+static void sim_nozzle_mmul(double c[_XN][_XN], double a[_XN][_XN], double b[_XN][_XN])
+{
+	int i, j, k;
+	for (i = 0; i < _XN; i++)
+		for (j = 0; j < _XN; j++)
+		{
+			c[i][j] = 0;
+			for (k = 0; k < _XN; k++)
+				c[i][j] += a[i][k] * b[k][j];
+		}
+}
+
+// calculate F and G for current parameters and time step
+// exp([A B; 0 0] * dt) = [F G; 0 I], evaluated in double by scaling and squaring of Taylor series
+static void sim_nozzle_exact_update(sim_nozzle_t* ps, float dt)
+{
+	double M[_XN][_XN]; // augmented matrix [A B; 0 0] * dt
+	double X[_XN][_XN]; // matrix exponential
+	double T[_XN][_XN]; // current Taylor term
+	double W[_XN][_XN]; // work matrix
+	memset(M, 0, sizeof(M));
+	M[0][0] = -1 / (ps->Rh * ps->Ch);
+	M[0][1] = 1 / (ps->Rh * ps->Ch);
+	M[0][3] = 1 / ps->Ch; // heater power
+	M[1][0] = 1 / (ps->Rh * ps->C);
+	M[1][1] = -(1 / ps->Rh + 1 / ps->R + 1 / ps->Rs) / ps->C;
+	M[1][2] = 1 / (ps->Rs * ps->C);
+	M[1][4] = -1 / ps->C; // extrussion power
+	M[2][1] = 1 / (ps->Rs * ps->Cs);
+	M[2][2] = -1 / (ps->Rs * ps->Cs);
+	// scale to norm < 0.5
+	double norm = 0;
+	int i, j, k;
+	for (i = 0; i < _XN; i++)
+	{
+		double rs = 0;
+		for (j = 0; j < _XN; j++)
+			rs += fabs(M[i][j] * dt);
+		if (rs > norm) norm = rs;
+	}
+	int sq = 0; // number of squarings
+	double scale = dt;
+	while (norm > 0.5)
+	{
+		norm /= 2;
+		scale /= 2;
+		sq++;
+	}
+	for (i = 0; i < _XN; i++)
+		for (j = 0; j < _XN; j++)
+		{
+			M[i][j] *= scale;
+			X[i][j] = T[i][j] = (i == j)?1:0;
+		}
+	// Taylor series
+	for (k = 1; k <= _XTERMS; k++)
+	{
+		sim_nozzle_mmul(W, T, M);
+		for (i = 0; i < _XN; i++)
+			for (j = 0; j < _XN; j++)
+			{
+				T[i][j] = W[i][j] / k;
+				X[i][j] += T[i][j];
+			}
+	}
+	// squaring
+	while (sq--)
+	{
+		sim_nozzle_mmul(W, X, X);
+		memcpy(X, W, sizeof(X));
+	}
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < 3; j++)
+			ps->xd.F[i][j] = X[i][j] - ((i == j)?1:0); // F - I, increments are added to state (less rounding)
+		ps->xd.G[i][0] = X[i][3];
+		ps->xd.G[i][1] = X[i][4];
+	}
+	ps->xd.dt = dt;
+	ps->xd.C = ps->C;
+	ps->xd.R = ps->R;
+	ps->xd.Ch = ps->Ch;
+	ps->xd.Rh = ps->Rh;
+	ps->xd.Cs = ps->Cs;
+	ps->xd.Rs = ps->Rs;
+}
+
+void sim_nozzle_cycle_exact(sim_nozzle_t* ps, float dt)
+{
+	sim_nozzle_exact_t* px = &ps->xd;
+	if ((px->dt != dt) || (px->C != ps->C) || (px->R != ps->R) || (px->Ch != ps->Ch) ||
+		(px->Rh != ps->Rh) || (px->Cs != ps->Cs) || (px->Rs != ps->Rs))
+		sim_nozzle_exact_update(ps, dt); // parameters changed
+	float x0 = ps->Th - ps->Ta; // state relative to ambient
+	float x1 = ps->T - ps->Ta;
+	float x2 = ps->Ts - ps->Ta;
+	float Px = ps->Ex * ps->vex; //[W] extrussion power
+	ps->Th += px->F[0][0] * x0 + px->F[0][1] * x1 + px->F[0][2] * x2 + px->G[0][0] * ps->P + px->G[0][1] * Px;
+	ps->T  += px->F[1][0] * x0 + px->F[1][1] * x1 + px->F[1][2] * x2 + px->G[1][0] * ps->P + px->G[1][1] * Px;
+	ps->Ts += px->F[2][0] * x0 + px->F[2][1] * x1 + px->F[2][2] * x2 + px->G[2][0] * ps->P + px->G[2][1] * Px;
+}
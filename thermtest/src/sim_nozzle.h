@@ -6,6 +6,17 @@
 #include <inttypes.h>
 
 
+// exact discretization of nozzle model for fixed time step 'dt' and constant inputs during step
+// state x = (Th, T, Ts) - Ta is advanced by x' = x + F * x + G * u, inputs u = (P, Ex * vex)
+// matrices are cached and recalculated only when dt or any of C, R, Ch, Rh, Cs, Rs changes
+typedef struct
+{
+	float dt;     // [s] time step of cached matrices (0 = not calculated)
+	float C, R, Ch, Rh, Cs, Rs; // parameters of cached matrices
+	float F[3][3]; // state transition matrix minus identity - exp(A * dt) - I
+	float G[3][2]; // input matrix - integral of exp(A * t) * B over step
+} sim_nozzle_exact_t;
+
 typedef struct
 {
 	float C;   // [J/K] total heat capacity of entire heat block
@@ -21,6 +32,7 @@ typedef struct
 	float P;   // [W] heater power
 	float Ex;  // [J/mm] extrussion energy factor
 	float vex; // [mm/s] extrussion speed
+	sim_nozzle_exact_t xd; // cached exact discretization (sim_nozzle_cycle_exact)
 } sim_nozzle_t;
 
 
@@ -28,5 +40,9 @@ extern void sim_nozzle_init(sim_nozzle_t* ps);
 extern void sim_nozzle_set_extrussion_speed(sim_nozzle_t* ps, float vex);
 extern void sim_nozzle_cycle(sim_nozzle_t* ps, float dt);
 
+// exact step of linear model (matrix exponential), heater power and extrussion speed are constant during step
+// no stability limit - 'dt' can be 10-100x longer than with sim_nozzle_cycle (explicit Euler) without loss of accuracy
+extern void sim_nozzle_cycle_exact(sim_nozzle_t* ps, float dt);
+
 
 #endif // _SIM_NOZZLE_H
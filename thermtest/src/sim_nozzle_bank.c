@@ -0,0 +1,151 @@
+// sim_nozzle_bank.c
+
+#include "sim_nozzle_bank.h"
+#include <string.h>
+
+
+// number of arrays in allocated block (7 parameters, 6 inputs/states, 7 coefficients)
+#define _BANK_ARRAYS 20
+
+
+int sim_nozzle_bank_init(sim_nozzle_bank_t* pb, int n, const sim_nozzle_t* ps, float dt)
+{
+	memset(pb, 0, sizeof(sim_nozzle_bank_t));
+	int nl = SIMD_LANES(n);
+	size_t size = (size_t)nl * _BANK_ARRAYS * sizeof(float);
+	float* p = SIMD_MALLOC(size); // allocate aligned memory block
+	if (p == 0)
+		return -1;
+	memset(p, 0, size);
+	pb->mem = p;
+	pb->n = n;
+	pb->nl = nl;
+	// distribute memory block
+	pb->C = p; p += nl;
+	pb->R = p; p += nl;
+	pb->Ch = p; p += nl;
+	pb->Rh = p; p += nl;
+	pb->Cs = p; p += nl;
+	pb->Rs = p; p += nl;
+	pb->Ex = p; p += nl;
+	pb->Ta = p; p += nl;
+	pb->T = p; p += nl;
+	pb->Th = p; p += nl;
+	pb->Ts = p; p += nl;
+	pb->P = p; p += nl;
+	pb->vex = p; p += nl;
+	pb->kh = p; p += nl;
+	pb->khb = p; p += nl;
+	pb->kbh = p; p += nl;
+	pb->kba = p; p += nl;
+	pb->kbs = p; p += nl;
+	pb->kbx = p; p += nl;
+	pb->ksb = p;
+	int i; for (i = 0; i < nl; i++) // including padding lanes
+		sim_nozzle_bank_set(pb, i, ps);
+	sim_nozzle_bank_update(pb, dt);
+	return 0;
+}
+
+void sim_nozzle_bank_done(sim_nozzle_bank_t* pb)
+{
+	if (pb->mem)
+		SIMD_FREE(pb->mem); // free aligned memory block
+	pb->mem = 0;
+}
+
+void sim_nozzle_bank_set(sim_nozzle_bank_t* pb, int i, const sim_nozzle_t* ps)
+{
+	pb->C[i] = ps->C;
+	pb->R[i] = ps->R;
+	pb->Ch[i] = ps->Ch;
+	pb->Rh[i] = ps->Rh;
+	pb->Cs[i] = ps->Cs;
+	pb->Rs[i] = ps->Rs;
+	pb->Ex[i] = ps->Ex;
+	pb->Ta[i] = ps->Ta;
+	pb->T[i] = ps->T;
+	pb->Th[i] = ps->Th;
+	pb->Ts[i] = ps->Ts;
+	pb->P[i] = ps->P;
+	pb->vex[i] = ps->vex;
+	if (pb->dt != 0) // update coefficients of this lane
+	{
+		pb->kh[i] = pb->dt / ps->Ch;
+		pb->khb[i] = pb->dt / (ps->Ch * ps->Rh);
+		pb->kbh[i] = pb->dt / (ps->C * ps->Rh);
+		pb->kba[i] = pb->dt / (ps->C * ps->R);
+		pb->kbs[i] = pb->dt / (ps->C * ps->Rs);
+		pb->kbx[i] = pb->dt * ps->Ex / ps->C;
+		pb->ksb[i] = pb->dt / (ps->Cs * ps->Rs);
+	}
+}
+
+void sim_nozzle_bank_get(sim_nozzle_bank_t* pb, int i, sim_nozzle_t* ps)
+{
+	ps->C = pb->C[i];
+	ps->R = pb->R[i];
+	ps->Ch = pb->Ch[i];
+	ps->Rh = pb->Rh[i];
+	ps->Cs = pb->Cs[i];
+	ps->Rs = pb->Rs[i];
+	ps->Ex = pb->Ex[i];
+	ps->Ta = pb->Ta[i];
+	ps->T = pb->T[i];
+	ps->Th = pb->Th[i];
+	ps->Ts = pb->Ts[i];
+	ps->P = pb->P[i];
+	ps->vex = pb->vex[i];
+}
+
+void sim_nozzle_bank_update(sim_nozzle_bank_t* pb, float dt)
+{
+	pb->dt = dt;
+	int i; for (i = 0; i < pb->nl; i++)
+	{
+		pb->kh[i] = dt / pb->Ch[i];
+		pb->khb[i] = dt / (pb->Ch[i] * pb->Rh[i]);
+		pb->kbh[i] = dt / (pb->C[i] * pb->Rh[i]);
+		pb->kba[i] = dt / (pb->C[i] * pb->R[i]);
+		pb->kbs[i] = dt / (pb->C[i] * pb->Rs[i]);
+		pb->kbx[i] = dt * pb->Ex[i] / pb->C[i];
+		pb->ksb[i] = dt / (pb->Cs[i] * pb->Rs[i]);
+	}
+}
+
+void sim_nozzle_bank_cycle(sim_nozzle_bank_t* pb, int steps)
+{
+	int l; for (l = 0; l < pb->nl; l += SIMD_WIDTH)
+	{
+		vf_t T = VLD(pb->T + l);
+		vf_t Th = VLD(pb->Th + l);
+		vf_t Ts = VLD(pb->Ts + l);
+		vf_t khb = VLD(pb->khb + l);
+		vf_t kbh = VLD(pb->kbh + l);
+		vf_t kba = VLD(pb->kba + l);
+		vf_t kbs = VLD(pb->kbs + l);
+		vf_t ksb = VLD(pb->ksb + l);
+		vf_t Ta = VLD(pb->Ta + l);
+		vf_t uh = VMUL(VLD(pb->kh + l), VLD(pb->P + l)); // heater temperature increase from heater power
+		vf_t ux = VMUL(VLD(pb->kbx + l), VLD(pb->vex + l)); // heat block temperature decrease from extrussion
+		vf_t ch = VSET(0); // compensation of rounded increments (increments near steady state are below half ulp of temperature)
+		vf_t cb = VSET(0);
+		vf_t cs = VSET(0);
+		int s; for (s = 0; s < steps; s++)
+		{
+			vf_t dhb = VSUB(Th, T); // heater - heat block temperature difference
+			vf_t dba = VSUB(T, Ta); // heat block - ambient temperature difference
+			vf_t dbs = VSUB(T, Ts); // heat block - sensor temperature difference
+			vf_t ih = VSUB(VSUB(uh, VMUL(khb, dhb)), ch); // increments minus lost low part of previous step
+			vf_t ib = VSUB(VSUB(VSUB(VMUL(kbh, dhb), VADD(VMUL(kba, dba), VMUL(kbs, dbs))), ux), cb);
+			vf_t is = VSUB(VMUL(ksb, dbs), cs);
+			vf_t t;
+			t = VADD(Th, ih); ch = VSUB(VSUB(t, Th), ih); Th = t;
+			t = VADD(T, ib); cb = VSUB(VSUB(t, T), ib); T = t;
+			t = VADD(Ts, is); cs = VSUB(VSUB(t, Ts), is); Ts = t;
+		}
+		VST(pb->T + l, T);
+		VST(pb->Th + l, Th);
+		VST(pb->Ts + l, Ts);
+	}
+}
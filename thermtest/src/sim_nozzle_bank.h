@@ -0,0 +1,69 @@
+// sim_nozzle_bank.h
+// bank of N nozzle simulators in structure-of-arrays layout, stepped together with SIMD kernels
+// model is the same as sim_nozzle_t, but the step is computed directly in temperatures with precomputed coefficients
+
+#ifndef _SIM_NOZZLE_BANK_H
+#define _SIM_NOZZLE_BANK_H
+
+#include "sim_nozzle.h"
+#include "simd.h"
+
+
+// simulator bank structure
+// all arrays have 'nl' elements (n rounded up to SIMD_WIDTH) and are aligned to vector size
+typedef struct
+{
+	int n;       // number of simulated nozzles
+	int nl;      // number of lanes
+	float dt;    // [s] simulation step used for coefficients
+	// parameters (call sim_nozzle_bank_update after change)
+	float* C;    // [J/K] total heat capacity of entire heat block
+	float* R;    // [K/W] absolute thermal resistance between heat block and ambient
+	float* Ch;   // [J/K] total heat capacity of heater
+	float* Rh;   // [K/W] absolute thermal resistance between heater and heat block
+	float* Cs;   // [J/K] total heat capacity of sensor
+	float* Rs;   // [K/W] absolute thermal resistance between sensor and heat block
+	float* Ex;   // [J/mm] extrussion energy factor
+	// inputs and state
+	float* Ta;   // [K] ambient temperature
+	float* T;    // [K] heat block temperature (avg)
+	float* Th;   // [K] heater temperature (avg)
+	float* Ts;   // [K] sensor temperature (avg)
+	float* P;    // [W] heater power
+	float* vex;  // [mm/s] extrussion speed
+	// precomputed coefficients
+	float* kh;   // dt / Ch
+	float* khb;  // dt / (Ch * Rh)
+	float* kbh;  // dt / (C * Rh)
+	float* kba;  // dt / (C * R)
+	float* kbs;  // dt / (C * Rs)
+	float* kbx;  // dt * Ex / C
+	float* ksb;  // dt / (Cs * Rs)
+	void* mem;   // allocated memory block
+} sim_nozzle_bank_t;
+
+
+// allocate bank of 'n' simulators, all lanes are initialized from template 'ps' (parameters and state)
+// returns 0 on success, -1 when allocation fails
+extern int sim_nozzle_bank_init(sim_nozzle_bank_t* pb, int n, const sim_nozzle_t* ps, float dt);
+
+// free allocated memory
+extern void sim_nozzle_bank_done(sim_nozzle_bank_t* pb);
+
+// copy parameters and state of lane 'i' from 'ps' (coefficients are updated)
+extern void sim_nozzle_bank_set(sim_nozzle_bank_t* pb, int i, const sim_nozzle_t* ps);
+
+// copy parameters and state of lane 'i' to 'ps'
+extern void sim_nozzle_bank_get(sim_nozzle_bank_t* pb, int i, sim_nozzle_t* ps);
+
+// recalculate precomputed coefficients of all lanes for simulation step 'dt'
+// this function must be called after any change of parameters (C, R, Ch, Rh, Cs, Rs, Ex)
+extern void sim_nozzle_bank_update(sim_nozzle_bank_t* pb, float dt);
+
+// do 'steps' simulation steps of all lanes, inputs (P, vex, Ta) are constant during this call
+// increments are added with compensated summation - near steady state they are below half ulp of temperature and plain
+// float steps stall up to 0.7K away from the solution, compensation is kept within one call only
+extern void sim_nozzle_bank_cycle(sim_nozzle_bank_t* pb, int steps);
+
+
+#endif // _SIM_NOZZLE_BANK_H
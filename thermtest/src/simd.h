@@ -0,0 +1,138 @@
+// simd.h
+// minimal float vector primitives shared by bank (structure-of-arrays) modules
+// width is selected at compile time: AVX = 8 lanes, SSE2 = 4 lanes, otherwise plain scalar code (1 lane)
+
+#ifndef _SIMD_H
+#define _SIMD_H
+
+#include <stdlib.h>
+#include <inttypes.h>
+
+#if defined(__AVX__)
+#define SIMD_WIDTH 8
+#elif defined(__SSE2__)
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 1
+#endif
+
+#if (SIMD_WIDTH > 1)
+#include <immintrin.h>
+// allocate/free memory aligned to vector size
+#define SIMD_MALLOC(size) _mm_malloc(size, SIMD_WIDTH * sizeof(float))
+#define SIMD_FREE(p)      _mm_free(p)
+#else
+#define SIMD_MALLOC(size) malloc(size)
+#define SIMD_FREE(p)      free(p)
+#endif
+
+// round lane count up to multiple of SIMD_WIDTH
+#define SIMD_LANES(n) (((n) + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH)
+
+// vector primitives - VSEL(m, a, b) selects 'b' in lanes where mask 'm' is set, 'a' elsewhere
+// only plain add/sub/mul/div/compare are used, so each lane rounds exactly like the scalar code in thermreg.c
+// (FMA contraction must stay disabled, which is the compiler default for non-FMA targets)
+#if (SIMD_WIDTH == 8)
+typedef __m256 vf_t;
+typedef __m256i vi_t;
+#define VLD(p)        _mm256_load_ps(p)
+#define VST(p, a)     _mm256_store_ps(p, a)
+#define VSET(x)       _mm256_set1_ps(x)
+#define VADD(a, b)    _mm256_add_ps(a, b)
+#define VSUB(a, b)    _mm256_sub_ps(a, b)
+#define VMUL(a, b)    _mm256_mul_ps(a, b)
+#define VDIV(a, b)    _mm256_div_ps(a, b)
+#define VLT(a, b)     _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define VLE(a, b)     _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define VGT(a, b)     _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define VGE(a, b)     _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define VANDN(m, n)   _mm256_andnot_ps(n, m)
+#define VSEL(m, a, b) _mm256_blendv_ps(a, b, m)
+#define VILD(p)       _mm256_load_si256((const __m256i*)(p))
+#define VIST(p, a)    _mm256_store_si256((__m256i*)(p), a)
+#define VISEL(m, a, c) _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(_mm256_set1_epi32(c)), m))
+#define VIOK(a)       _mm256_cmp_ps(_mm256_cvtepi32_ps(a), _mm256_setzero_ps(), _CMP_EQ_OQ)
+#elif (SIMD_WIDTH == 4)
+typedef __m128 vf_t;
+typedef __m128i vi_t;
+#define VLD(p)        _mm_load_ps(p)
+#define VST(p, a)     _mm_store_ps(p, a)
+#define VSET(x)       _mm_set1_ps(x)
+#define VADD(a, b)    _mm_add_ps(a, b)
+#define VSUB(a, b)    _mm_sub_ps(a, b)
+#define VMUL(a, b)    _mm_mul_ps(a, b)
+#define VDIV(a, b)    _mm_div_ps(a, b)
+#define VLT(a, b)     _mm_cmplt_ps(a, b)
+#define VLE(a, b)     _mm_cmple_ps(a, b)
+#define VGT(a, b)     _mm_cmpgt_ps(a, b)
+#define VGE(a, b)     _mm_cmpge_ps(a, b)
+#define VANDN(m, n)   _mm_andnot_ps(n, m)
+#define VSEL(m, a, b) _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a))
+#define VILD(p)       _mm_load_si128((const __m128i*)(p))
+#define VIST(p, a)    _mm_store_si128((__m128i*)(p), a)
+#define VISEL(m, a, c) _mm_castps_si128(VSEL(m, _mm_castsi128_ps(a), _mm_castsi128_ps(_mm_set1_epi32(c))))
+#define VIOK(a)       _mm_castsi128_ps(_mm_cmpeq_epi32(a, _mm_setzero_si128()))
+#else
+typedef float vf_t;
+typedef int vi_t;
+#define VLD(p)        (*(p))
+#define VST(p, a)     (*(p) = (a))
+#define VSET(x)       (x)
+#define VADD(a, b)    ((a) + (b))
+#define VSUB(a, b)    ((a) - (b))
+#define VMUL(a, b)    ((a) * (b))
+#define VDIV(a, b)    ((a) / (b))
+#define VLT(a, b)     ((a) < (b))
+#define VLE(a, b)     ((a) <= (b))
+#define VGT(a, b)     ((a) > (b))
+#define VGE(a, b)     ((a) >= (b))
+#define VANDN(m, n)   ((m) && !(n))
+#define VSEL(m, a, b) ((m)?(b):(a))
+#define VILD(p)       (*(p))
+#define VIST(p, a)    (*(p) = (a))
+#define VISEL(m, a, c) ((m)?(c):(a))
+#define VIOK(a)       ((a) == 0)
+#endif
+
+// 32-bit unsigned integer vector primitives (counter-based random generator in disturb.c)
+// integer width is selected separately: AVX2 = 8 lanes, SSE2 = 4 lanes (AVX without AVX2 has no 256-bit integer ops)
+// loads and stores are unaligned, VUSEQ(x) = (x, x + 1, ... x + SIMDI_WIDTH - 1), rotation count 'r' must be constant
+#if defined(__AVX2__)
+#define SIMDI_WIDTH 8
+#elif defined(__SSE2__)
+#define SIMDI_WIDTH 4
+#else
+#define SIMDI_WIDTH 1
+#endif
+
+#if (SIMDI_WIDTH == 8)
+typedef __m256i vu_t;
+#define VULD(p)       _mm256_loadu_si256((const __m256i*)(p))
+#define VUST(p, a)    _mm256_storeu_si256((__m256i*)(p), a)
+#define VUSET(x)      _mm256_set1_epi32((int)(x))
+#define VUSEQ(x)      _mm256_add_epi32(_mm256_set1_epi32((int)(x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+#define VUADD(a, b)   _mm256_add_epi32(a, b)
+#define VUXOR(a, b)   _mm256_xor_si256(a, b)
+#define VUROTL(a, r)  _mm256_or_si256(_mm256_slli_epi32(a, r), _mm256_srli_epi32(a, 32 - (r)))
+#elif (SIMDI_WIDTH == 4)
+typedef __m128i vu_t;
+#define VULD(p)       _mm_loadu_si128((const __m128i*)(p))
+#define VUST(p, a)    _mm_storeu_si128((__m128i*)(p), a)
+#define VUSET(x)      _mm_set1_epi32((int)(x))
+#define VUSEQ(x)      _mm_add_epi32(_mm_set1_epi32((int)(x)), _mm_setr_epi32(0, 1, 2, 3))
+#define VUADD(a, b)   _mm_add_epi32(a, b)
+#define VUXOR(a, b)   _mm_xor_si128(a, b)
+#define VUROTL(a, r)  _mm_or_si128(_mm_slli_epi32(a, r), _mm_srli_epi32(a, 32 - (r)))
+#else
+typedef uint32_t vu_t;
+#define VULD(p)       (*(p))
+#define VUST(p, a)    (*(p) = (a))
+#define VUSET(x)      ((uint32_t)(x))
+#define VUSEQ(x)      ((uint32_t)(x))
+#define VUADD(a, b)   ((a) + (b))
+#define VUXOR(a, b)   ((a) ^ (b))
+#define VUROTL(a, r)  (((a) << (r)) | ((a) >> (32 - (r))))
+#endif
+
+
+#endif // _SIMD_H
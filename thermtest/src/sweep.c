@@ -0,0 +1,140 @@
+// sweep.c
+
+#include "sweep.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// init callback wrapper - base initialization, then check parameters of grid point
+typedef struct
+{
+	scenario_init_t* init;
+	void* param;
+	const sweep_point_t* pp;
+} sweep_init_t;
+
+static void sweep_init(thermreg_t* pr, sim_nozzle_t* ps, void* param)
+{
+	sweep_init_t* pi = (sweep_init_t*)param;
+	pi->init(pr, ps, pi->param);
+	sweep_apply(pr, pi->pp);
+}
+
+
+void sweep_apply(thermreg_t* pr, const sweep_point_t* pp)
+{
+	int est = pr->est;
+	float lam = pr->lam;
+	int estw = pr->estw;
+	int eleak = pr->eleak;
+	int pblk = pr->pblk;
+	thermreg_init(pr, pr->dt, pr->Pmax, pr->kP, pr->kI, pr->ebufl, pr->Tmin, pr->Tmax, pr->Tss, pr->Tso, pp->C, pp->R, pp->ncycl, pp->pbufl, -pp->Pdl, pp->Pdl);
+	if (eleak)
+		thermreg_leaky_init(pr);
+	if (pblk > 1)
+		thermreg_decim_init(pr, pp->pbufl / pblk, pblk); // same window with decimating averager
+	if (est)
+		thermreg_est_init(pr, lam, estw); // estimation starts from C and R of grid point
+}
+
+
+int sweep_grid(sweep_point_t* pp, int max, const int* ncycl, int nncycl, const int* pbufl, int npbufl, const float* Pdl, int nPdl, const float* C, int nC, const float* R, int nR)
+{
+	int count = 0;
+	int a, b, c, d, e;
+	for (a = 0; a < nncycl; a++)
+		for (b = 0; b < npbufl; b++)
+			for (c = 0; c < nPdl; c++)
+				for (d = 0; d < nC; d++)
+					for (e = 0; e < nR; e++)
+					{
+						if (count >= max) return count;
+						sweep_point_t* p = &pp[count++];
+						p->ncycl = ncycl[a];
+						p->pbufl = pbufl[b];
+						p->Pdl = Pdl[c];
+						p->C = C[d];
+						p->R = R[e];
+					}
+	return count;
+}
+
+float sweep_fault_time(const scenario_t* psc)
+{
+	int i; for (i = 0; i < psc->nevents; i++)
+	{
+		const scenario_event_t* pev = &psc->events[i];
+		if (((pev->type == scenario_event_HEATER) && (pev->value < 1)) || (pev->type == scenario_event_SENSOR))
+			return pev->t;
+	}
+	return -1;
+}
+
+void sweep_run(const scenario_t* psc, int count, scenario_init_t* init, void* param, const sweep_point_t* pp, int npoints, sweep_result_t* pres, int nthreads, int flags)
+{
+	scenario_result_t* res = malloc(count * sizeof(scenario_result_t));
+	int p, i;
+	for (p = 0; p < npoints; p++)
+	{
+		sweep_init_t si = {init, param, &pp[p]};
+		sweep_result_t* pr = &pres[p];
+		memset(pr, 0, sizeof(sweep_result_t));
+		scenario_run_all(psc, count, sweep_init, &si, res, nthreads, flags);
+		float tsum = 0;
+		for (i = 0; i < count; i++)
+		{
+			float tf = sweep_fault_time(&psc[i]);
+			int err = (res[i].error != thermreg_error_OK);
+			if (tf < 0)
+			{
+				pr->nnominal++;
+				if (err) pr->trips++;
+			}
+			else
+			{
+				pr->nfault++;
+				if (err && (res[i].terror < tf))
+					pr->trips++; // error before fault
+				else if (err)
+				{
+					float lat = res[i].terror - tf; // detection latency
+					pr->detected++;
+					tsum += lat;
+					if (lat > pr->tmax) pr->tmax = lat;
+				}
+			}
+		}
+		pr->tmean = pr->detected?(tsum / pr->detected):-1;
+		if (pr->detected == 0) pr->tmax = -1;
+	}
+	free(res);
+}
+
+void sweep_print(FILE* out, const sweep_point_t* pp, const sweep_result_t* pres, int npoints)
+{
+	fprintf(out, "%5s %5s %6s %6s %6s %9s %8s %8s %6s\n", "ncycl", "pbufl", "Pdl", "C", "R", "detected", "t_mean", "t_max", "trips");
+	int p; for (p = 0; p < npoints; p++)
+	{
+		const sweep_point_t* ps = &pp[p];
+		const sweep_result_t* pr = &pres[p];
+		fprintf(out, "%5d %5d %6.1f %6.2f %6.2f %4d/%-4d %8.2f %8.2f %2d/%-3d\n", ps->ncycl, ps->pbufl, ps->Pdl, ps->C, ps->R,
+			pr->detected, pr->nfault, pr->tmean, pr->tmax, pr->trips, pr->nnominal + pr->nfault);
+	}
+}
+
+int sweep_write_tsv(const char* filename, const sweep_point_t* pp, const sweep_result_t* pres, int npoints)
+{
+	FILE* f = fopen(filename, "w");
+	if (f == 0) return -1;
+	fprintf(f, "ncycl\tpbufl\tPdl\tC\tR\tnfault\tdetected\tt_mean\tt_max\tnnominal\ttrips\tfp_rate\n");
+	int p; for (p = 0; p < npoints; p++)
+	{
+		const sweep_point_t* ps = &pp[p];
+		const sweep_result_t* pr = &pres[p];
+		int n = pr->nnominal + pr->nfault;
+		fprintf(f, "%d\t%d\t%.2f\t%.3f\t%.3f\t%d\t%d\t%.2f\t%.2f\t%d\t%d\t%.3f\n", ps->ncycl, ps->pbufl, ps->Pdl, ps->C, ps->R,
+			pr->nfault, pr->detected, pr->tmean, pr->tmax, pr->nnominal, pr->trips, n?((float)pr->trips / n):0);
+	}
+	fclose(f);
+	return 0;
+}
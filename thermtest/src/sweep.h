@@ -0,0 +1,54 @@
+// sweep.h
+// safety check tuning sweep - runs scenario table for grid of check parameters (ncycl, pbufl, power difference limit, C, R)
+// reports detection latency of fault scenarios and false trips of nominal scenarios for each grid point
+
+#ifndef _SWEEP_H
+#define _SWEEP_H
+
+#include <stdio.h>
+#include "scenario.h"
+
+
+// grid point - check parameters
+typedef struct
+{
+	int ncycl;     // number of regulator cycles per one error check cycle
+	int pbufl;     // length of power difference buffer
+	float Pdl;     // power difference limit [W] (Pdnl = -Pdl, Pdpl = Pdl)
+	float C;       // thermal capacity of entire system [J/K]
+	float R;       // thermal resistance between entire system and ambient [K/W]
+} sweep_point_t;
+
+// grid point result
+typedef struct
+{
+	int nfault;    // number of fault scenarios
+	int detected;  // number of detected faults (error after fault event)
+	float tmean;   // mean detection latency of detected faults [s]
+	float tmax;    // maximum detection latency of detected faults [s]
+	int nnominal;  // number of nominal scenarios
+	int trips;     // number of false trips (error in nominal scenario or before fault event)
+} sweep_result_t;
+
+
+// fill grid from parameter lists, returns number of grid points
+extern int sweep_grid(sweep_point_t* pp, int max, const int* ncycl, int nncycl, const int* pbufl, int npbufl, const float* Pdl, int nPdl, const float* C, int nC, const float* R, int nR);
+
+// replace check parameters of initialized regulator by grid point (regulator modes of base initialization are kept)
+extern void sweep_apply(thermreg_t* pr, const sweep_point_t* pp);
+
+// time of first fault event of scenario [s] (heater factor < 1 or sensor failure), -1 = nominal scenario
+extern float sweep_fault_time(const scenario_t* psc);
+
+// run scenario table for each grid point, regulator is initialized by 'init' and check parameters are replaced by grid point
+// scenarios of each grid point run in parallel on 'nthreads' threads (0 = all cpu cores), 'flags' as for scenario_run_all
+extern void sweep_run(const scenario_t* psc, int count, scenario_init_t* init, void* param, const sweep_point_t* pp, int npoints, sweep_result_t* pres, int nthreads, int flags);
+
+// print compact result table
+extern void sweep_print(FILE* out, const sweep_point_t* pp, const sweep_result_t* pres, int npoints);
+
+// write heat map data (TSV, one line per grid point with header), returns 0 on success, -1 on error
+extern int sweep_write_tsv(const char* filename, const sweep_point_t* pp, const sweep_result_t* pres, int npoints);
+
+
+#endif // _SWEEP_H
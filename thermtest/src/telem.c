@@ -0,0 +1,66 @@
+// telem.c
+
+#include "telem.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// logger poll interval when ring is empty [ns]
+#define TELEM_POLL_NS 1000000
+
+
+static void* telem_logger(void* param)
+{
+	telem_t* pt = (telem_t*)param;
+	for (;;)
+	{
+		int stop = __atomic_load_n(&pt->stop, __ATOMIC_ACQUIRE); // read before head - rows pushed before stop are drained
+		uint32_t t = pt->tail;
+		uint32_t h = __atomic_load_n(&pt->head, __ATOMIC_ACQUIRE);
+		if (h == t)
+		{
+			if (stop)
+				break;
+			struct timespec ts = {0, TELEM_POLL_NS};
+			nanosleep(&ts, 0);
+			continue;
+		}
+		for (; t != h; t++)
+			trace_write(pt->pw, &pt->buff[t & pt->mask]);
+		__atomic_store_n(&pt->tail, t, __ATOMIC_RELEASE); // release slots to producer
+	}
+	return 0;
+}
+
+int telem_init(telem_t* pt, uint32_t capacity, trace_writer_t* pw)
+{
+	memset(pt, 0, sizeof(telem_t));
+	uint32_t n = 1;
+	while (n < (capacity?capacity:TELEM_CAPACITY))
+		n <<= 1;
+	pt->buff = malloc(n * sizeof(trace_sample_t));
+	if (pt->buff == 0)
+		return -1;
+	memset(pt->buff, 0, n * sizeof(trace_sample_t)); // touch pages before use in control loop
+	pt->mask = n - 1;
+	pt->pw = pw;
+	return 0;
+}
+
+int telem_start(telem_t* pt)
+{
+	pt->running = (pthread_create(&pt->thread, 0, telem_logger, pt) == 0);
+	return pt->running?0:-1;
+}
+
+void telem_done(telem_t* pt)
+{
+	if (pt->buff == 0) return;
+	__atomic_store_n(&pt->stop, 1, __ATOMIC_RELEASE);
+	if (pt->running)
+		pthread_join(pt->thread, 0);
+	pt->running = 0;
+	free(pt->buff);
+	pt->buff = 0;
+}
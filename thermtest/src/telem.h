@@ -0,0 +1,73 @@
+// telem.h
+// telemetry channel - bounded lock-free single-producer/single-consumer ring of trace rows
+// control loop pushes rows (copy + one release store, never blocks), logger thread drains them to trace writer
+// when ring is full, new rows are dropped and counted - latency of control loop does not depend on logging throughput
+
+#ifndef _TELEM_H
+#define _TELEM_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include "trace.h"
+
+// default ring capacity (rows, power of two) - 16384 rows = 164s of 10ms cycles
+#define TELEM_CAPACITY 16384
+
+// size of cache line - producer and consumer indexes are on separate lines (no false sharing), both start a line
+// (aligned members - structure is aligned to cache line also on stack and in static storage)
+#define TELEM_CACHE_LINE 64
+
+
+// telemetry channel
+typedef struct
+{
+	// producer (control loop)
+	volatile uint32_t head __attribute__((aligned(TELEM_CACHE_LINE))); // next write index (free running, published with release store)
+	uint32_t tailc;         // cached consumer index (refreshed only when ring looks full)
+	uint64_t pushed;        // number of pushed rows
+	uint64_t drops;         // number of dropped rows (ring full)
+	uint8_t pad0[TELEM_CACHE_LINE - 24];
+	// consumer (logger thread)
+	volatile uint32_t tail __attribute__((aligned(TELEM_CACHE_LINE))); // next read index (free running, published with release store)
+	volatile int stop;      // stop request - logger drains ring and exits
+	uint8_t pad1[TELEM_CACHE_LINE - 8];
+	// shared, constant after init
+	uint32_t mask;          // capacity - 1
+	trace_sample_t* buff;   // ring buffer
+	trace_writer_t* pw;     // output trace writer
+	pthread_t thread;       // logger thread
+	int running;            // logger thread started
+} telem_t;
+
+
+// allocate ring with 'capacity' rows (rounded up to power of two, 0 = TELEM_CAPACITY), rows will be written to 'pw'
+// returns 0 on success, -1 when allocation fails
+extern int telem_init(telem_t* pt, uint32_t capacity, trace_writer_t* pw);
+
+// start logger thread, returns 0 on success, -1 when thread cannot be created
+extern int telem_start(telem_t* pt);
+
+// stop logger thread after remaining rows are written, free ring
+extern void telem_done(telem_t* pt);
+
+// push one row (producer only), returns 1 when pushed, 0 when ring is full (row is dropped and counted)
+static inline int telem_push(telem_t* pt, const trace_sample_t* ps)
+{
+	uint32_t h = pt->head;
+	if (h - pt->tailc > pt->mask) // looks full - refresh consumer index
+	{
+		pt->tailc = __atomic_load_n(&pt->tail, __ATOMIC_ACQUIRE);
+		if (h - pt->tailc > pt->mask)
+		{
+			pt->drops++;
+			return 0;
+		}
+	}
+	pt->buff[h & pt->mask] = *ps;
+	__atomic_store_n(&pt->head, h + 1, __ATOMIC_RELEASE); // publish row
+	pt->pushed++;
+	return 1;
+}
+
+
+#endif // _TELEM_H
@@ -0,0 +1,92 @@
+// thermrec.c
+
+#include "thermrec.h"
+
+
+#define _0C 273.15F
+
+
+void thermrec_init(thermrec_t* prec, thermreg_t* pr, thermrec_sample_t* buff, uint16_t len, uint16_t pre, uint16_t post)
+{
+	prec->pr = pr;         // attached regulator
+	prec->buff = buff;     // sample ring buffer
+	prec->len = len;       // length of sample buffer
+	if (post > len - 1) post = len - 1;
+	if (pre > len - 1 - post) pre = len - 1 - post;
+	prec->pre = pre;       // number of samples before trigger
+	prec->post = post;     // number of samples after trigger
+	thermrec_arm(prec);
+}
+
+void thermrec_cycle(thermrec_t* prec)
+{
+	if (prec->state == thermrec_state_FROZEN)
+		return;
+	thermreg_t* pr = prec->pr;
+	thermrec_sample_t* ps = prec->buff + prec->idx;
+	ps->cycle = prec->cycle++;
+	ps->Tc = pr->Tc;
+	ps->P = pr->P;
+	ps->Pc = pr->Pc;
+	ps->Pda = pr->Pda;
+	ps->ebufs = pr->ebufs;
+	ps->pbufs = pr->pbufs;
+	ps->error = pr->error;
+	if (++prec->idx >= prec->len) // increment index
+		prec->idx = 0;
+	if (prec->count < prec->len) // buffer is not full?
+		prec->count++;
+	if (prec->state == thermrec_state_TRIGGERED)
+	{
+		if (--prec->remain == 0) // all post-trigger samples recorded?
+			prec->state = thermrec_state_FROZEN;
+	}
+	else if (pr->error != thermreg_error_OK)
+		thermrec_trigger(prec);
+}
+
+void thermrec_trigger(thermrec_t* prec)
+{
+	if (prec->state != thermrec_state_ARMED)
+		return;
+	prec->trig = prec->cycle - 1; // last recorded sample is trigger sample
+	prec->remain = prec->post;
+	prec->state = (prec->remain > 0)?thermrec_state_TRIGGERED:thermrec_state_FROZEN;
+}
+
+void thermrec_arm(thermrec_t* prec)
+{
+	prec->idx = 0;
+	prec->count = 0;
+	prec->remain = 0;
+	prec->cycle = 0;
+	prec->trig = 0;
+	prec->state = thermrec_state_ARMED;
+}
+
+uint16_t thermrec_count(thermrec_t* prec)
+{
+	if (prec->state != thermrec_state_FROZEN)
+		return 0;
+	uint16_t n = prec->pre + 1 + prec->post; // window length
+	return (n < prec->count)?n:prec->count;
+}
+
+const thermrec_sample_t* thermrec_get(thermrec_t* prec, uint16_t i)
+{
+	int j = (int)prec->idx - thermrec_count(prec) + i; // index of sample in ring buffer
+	if (j < 0) j += prec->len;
+	return prec->buff + j;
+}
+
+void thermrec_dump(thermrec_t* prec, FILE* out, float dt)
+{
+	uint16_t n = thermrec_count(prec);
+	fprintf(out, "# trigger at cycle %u, %u samples\n", (unsigned)prec->trig, (unsigned)n);
+	uint16_t i; for (i = 0; i < n; i++)
+	{
+		const thermrec_sample_t* ps = thermrec_get(prec, i);
+		float t = ((int32_t)(ps->cycle - prec->trig)) * dt; // time relative to trigger [s]
+		fprintf(out, "%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t, ps->Tc - _0C, ps->P, ps->Pc, ps->Pda, ps->ebufs, ps->pbufs, (int)ps->error);
+	}
+}
@@ -0,0 +1,75 @@
+// thermrec.h
+// flight recorder for thermreg_t - keeps last samples in caller provided ring buffer,
+// freezes window of 'pre' samples before and 'post' samples after error is set (trigger)
+
+#ifndef _THERMREC_H
+#define _THERMREC_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "thermreg.h"
+
+
+// recorder states
+typedef enum
+{
+	thermrec_state_ARMED = 0,     // recording, waiting for trigger
+	thermrec_state_TRIGGERED = 1, // recording post-trigger samples
+	thermrec_state_FROZEN = 2,    // window complete, recording stopped
+} thermrec_state_t;
+
+// one recorded sample - 32 bytes
+typedef struct
+{
+	uint32_t cycle; // regulator cycle number
+	float Tc;       // current temperature [K]
+	float P;        // output power [W]
+	float Pc;       // calculated power [W]
+	float Pda;      // average power difference [W]
+	float ebufs;    // sum of error buffer
+	float pbufs;    // sum of power difference buffer
+	int32_t error;  // regulator error (thermreg_error_t)
+} thermrec_sample_t;
+
+// recorder structure
+typedef struct
+{
+	thermreg_t* pr;          // attached regulator
+	thermrec_sample_t* buff; // sample ring buffer
+	uint16_t len;            // length of sample buffer
+	uint16_t pre;            // number of samples before trigger
+	uint16_t post;           // number of samples after trigger
+	uint16_t idx;            // index of next sample in buffer
+	uint16_t count;          // count of samples in buffer
+	uint16_t remain;         // remaining post-trigger samples
+	uint8_t state;           // recorder state (thermrec_state_t)
+	uint32_t cycle;          // cycle counter
+	uint32_t trig;           // cycle number of trigger
+} thermrec_t;
+
+
+// attach recorder to regulator, 'buff' is sample buffer of 'len' samples (no allocation)
+// 'pre' + 'post' is limited to 'len' - 1, recorder is armed
+extern void thermrec_init(thermrec_t* prec, thermreg_t* pr, thermrec_sample_t* buff, uint16_t len, uint16_t pre, uint16_t post);
+
+// record one sample, triggers when regulator error is set
+// this function should be called after each call of thermreg_check
+extern void thermrec_cycle(thermrec_t* prec);
+
+// manual trigger (same as regulator error)
+extern void thermrec_trigger(thermrec_t* prec);
+
+// empty buffer and arm recorder again
+extern void thermrec_arm(thermrec_t* prec);
+
+// return number of samples in frozen window (0 when not frozen)
+extern uint16_t thermrec_count(thermrec_t* prec);
+
+// return sample 'i' of frozen window (0 = oldest)
+extern const thermrec_sample_t* thermrec_get(thermrec_t* prec, uint16_t i);
+
+// print frozen window as TSV (t Tc P Pc Pda ebufs pbufs error), time is relative to trigger, 'dt' is regulation period
+extern void thermrec_dump(thermrec_t* prec, FILE* out, float dt);
+
+
+#endif // _THERMREC_H
@@ -1,9 +1,41 @@
 // thermreg.c
 
 #include "thermreg.h"
-#include <stdlib.h>
+#include <math.h>
 
 
+// maximum change of estimated C and 1/R in one estimation window (fraction of nominal value)
+#define _EST_RATE (1.0F / 16)
+
+// range of estimated C and 1/R (factor of nominal value in both directions)
+#define _EST_RANGE 4
+
+// minimum power of heat capacity term in window (nominal C * dT/dt) for update of estimated C [W]
+#define _EST_EXC 1.0F
+
+
+// put value 'v' into ring buffer 'buff' of length 'l' (index 'pi', count 'pc') and update sum of all values 'ps'
+// lap sum 'pn' adds each value written in current lap - at end of lap (index wraps to 0) it is the sum of whole buffer
+// (the same order of additions as sum of buff[0..l-1]) and replaces running sum, rounding error of add/subtract cannot
+// accumulate over more than one lap, sum stays exact within float rounding in arbitrarily long runs
+// renormalization is spread over the lap - two additions per push, no O(l) loop in any cycle
+static void thermreg_ring_push(float* buff, int l, int* pi, int* pc, float* ps, float* pn, float v)
+{
+	if (*pc < l) // buffer is not full?
+		(*pc)++;  // increment count
+	else
+		*ps -= buff[*pi]; // subtract old value from sum
+	buff[*pi] = v; // put new value into buffer
+	*ps += v; // add new value to sum
+	*pn += v; // add new value to lap sum
+	if (++(*pi) >= l) // increment index, end of lap?
+	{
+		*pi = 0;
+		*ps = *pn; // renormalize - sum of all values in buffer
+		*pn = 0;
+	}
+}
+
 void thermreg_init(thermreg_t* pr, float dt, float Pmax, float kP, float kI, int ebufl, float Tmin, float Tmax, float Tss, float Tso, float C, float R, int ncycl, int pbufl, float Pdnl, float Pdpl)
 {
 //	memset(pr, 0, sizeof(thermreg_t));
@@ -13,6 +45,7 @@ void thermreg_init(thermreg_t* pr, float dt, float Pmax, float kP, float kI, int
 	pr->kP = kP;        // proportional constant
 	pr->kI = kI;        // integration constant
 	pr->ebufl = ebufl;  // length of error buffer
+	pr->eleak = 0;      // sliding window integration
 	pr->Ta = 293.15;    // ambient temperature [K]
 	pr->Tmin = Tmin;    // temperature limit for mintemp error [K]
 	pr->Tmax = Tmax;    // temperature limit for maxtemp error [K]
@@ -22,21 +55,14 @@ void thermreg_init(thermreg_t* pr, float dt, float Pmax, float kP, float kI, int
 	pr->R = R;          // thermal resistance between entire system and ambient []
 	pr->ncycl = ncycl;  // number of regulator cycles per one error check cycle
 	pr->pbufl = pbufl;  // length of power difference buffer
+	pr->pblk = 1;       // exact moving average
 	pr->Pdnl = Pdnl;    // negative power difference limit [W]
 	pr->Pdpl = Pdpl;    // positive power difference limit [W]
+	pr->cycl = 0;       // error check cycle counter
+	pr->Pc = 0;         // calculated output power [W]
+	pr->Pda = 0;        // average power difference [W]
+	pr->est = 0;        // estimation disabled
 	thermreg_reset(pr);
-	if (ebufl > 0)
-		pr->ebuff = malloc(ebufl * sizeof(float)); // allocate error buffer
-	if (pbufl > 0)
-		pr->pbuff = malloc(pbufl * sizeof(float)); // allocate power difference buffer
-}
-
-void thermreg_done(thermreg_t* pr)
-{
-	if (pr->ebuff)
-		free(pr->ebuff); // free error buffer
-	if (pr->pbuff)
-		free(pr->pbuff); // allocate power difference buffer
 }
 
 void thermreg_input(thermreg_t* pr, float Tc)
@@ -68,14 +94,25 @@ void thermreg_cycle(thermreg_t* pr)
 {
 	// calculate regulation
 	float err = pr->Tt - pr->Tc; // regulation error
-	// put error value into ring buffer and calculate sum of all values in buffer (ebufs)
-	if (pr->ebufc < pr->ebufl) // error buffer is not full?
-		pr->ebufc++;  // increment count
+	if (pr->eleak)
+	{
+		// leaky integrator - ebufs / ebufl is exponential average of error
+		pr->ebufs += pr->ealpha * (err * pr->ebufl - pr->ebufs);
+		// anti-windup - integration part is limited so that output stays within Pmin..Pmax (integral action, kI > 0 only)
+		if (pr->kI > 0)
+		{
+			float Pp = err * pr->kP; // proportional part
+			float emin = (pr->Pmin - Pp) * pr->ebufl / pr->kI;
+			float emax = (pr->Pmax - Pp) * pr->ebufl / pr->kI;
+			if (pr->ebufs > emax) pr->ebufs = emax;
+			if (pr->ebufs < emin) pr->ebufs = emin;
+		}
+	}
 	else
-		pr->ebufs -= pr->ebuff[pr->ebufi]; // subtract old value from error buffer sum
-	pr->ebuff[pr->ebufi] = err; // put new value into buffer
-	pr->ebufs += err; // add new value to error buffer sum
-	pr->ebufi = (pr->ebufi + 1) % pr->ebufl; // increment index
+	{
+		// put error value into ring buffer and calculate sum of all values in buffer (ebufs)
+		thermreg_ring_push(THERMREG_EBUFF(pr), pr->ebufl, &pr->ebufi, &pr->ebufc, &pr->ebufs, &pr->ebufn, err);
+	}
 	// calculate output power
 	float out = err * pr->kP + pr->ebufs * pr->kI / pr->ebufl;
 	// limit output power
@@ -88,36 +125,160 @@ void thermreg_cycle(thermreg_t* pr)
 		pr->P = 0; // set output power to zero
 }
 
+// one step of recursive least squares, regressors - temperature change rate 'dTdt' [K/s], temperature difference 'dTa' [K]
+static void thermreg_est_update(thermreg_t* pr, float P, float dTdt, float dTa)
+{
+	float x0 = dTdt; // regressor of C
+	float x1 = dTa;  // regressor of 1/R
+	float e = P - (pr->th[0] * x0 + pr->th[1] * x1); // prediction error [W]
+	if ((e <= 0.5F * pr->Pdnl) || (e >= 0.5F * pr->Pdpl))
+		return; // outlier (fault or sudden change) - estimate is frozen, only slow drift is learned
+	if (fabsf(x0 * pr->C) < _EST_EXC)
+	{
+		x0 = 0; // no excitation of C (stable temperature) - only 1/R is updated, C keeps value learned during heating
+		pr->cov[1] = 0;
+	}
+	float p0 = pr->cov[0] * x0 + pr->cov[1] * x1; // cov * x
+	float p1 = pr->cov[1] * x0 + pr->cov[2] * x1;
+	float lam = pr->lam;
+	float d = lam + x0 * p0 + x1 * p1;
+	float k0 = p0 / d; // gain
+	float k1 = p1 / d;
+	// rate limit - estimate follows slow drift, step of one window is limited
+	float d0 = k0 * e;
+	float d1 = k1 * e;
+	if (d0 > _EST_RATE * pr->C) d0 = _EST_RATE * pr->C;
+	if (d0 < -_EST_RATE * pr->C) d0 = -_EST_RATE * pr->C;
+	if (d1 > _EST_RATE / pr->R) d1 = _EST_RATE / pr->R;
+	if (d1 < -_EST_RATE / pr->R) d1 = -_EST_RATE / pr->R;
+	pr->th[0] += d0;
+	pr->th[1] += d1;
+	pr->cov[0] = (pr->cov[0] - k0 * p0) / lam;
+	pr->cov[1] = (pr->cov[1] - k0 * p1) / lam;
+	pr->cov[2] = (pr->cov[2] - k1 * p1) / lam;
+	// covariance limit - without excitation of one regressor (dT/dt at stable temperature) forgetting would blow up its
+	// variance, variance is kept within initial value per parameter, the other parameter keeps its tracking gain
+	if (pr->cov[0] > pr->C * pr->C)
+	{
+		pr->cov[1] *= pr->C / sqrtf(pr->cov[0]);
+		pr->cov[0] = pr->C * pr->C;
+	}
+	if (pr->cov[2] * pr->R * pr->R > 1)
+	{
+		pr->cov[1] /= pr->R * sqrtf(pr->cov[2]);
+		pr->cov[2] = 1 / (pr->R * pr->R);
+	}
+	// limit estimate to nominal range
+	if (pr->th[0] < pr->C / _EST_RANGE) pr->th[0] = pr->C / _EST_RANGE;
+	if (pr->th[0] > pr->C * _EST_RANGE) pr->th[0] = pr->C * _EST_RANGE;
+	if (pr->th[1] < 1 / (pr->R * _EST_RANGE)) pr->th[1] = 1 / (pr->R * _EST_RANGE);
+	if (pr->th[1] > _EST_RANGE / pr->R) pr->th[1] = _EST_RANGE / pr->R;
+}
+
+// accumulate window averages in check cycle, update estimate at end of window
+static void thermreg_est_cycle(thermreg_t* pr)
+{
+	// healthy heater - no error, average power difference of estimated model within half of limits
+	if ((pr->error != thermreg_error_OK) || (pr->Pdae <= 0.5F * pr->Pdnl) || (pr->Pdae >= 0.5F * pr->Pdpl))
+		pr->estc = -1; // discard window
+	if (pr->estc < 0) // start of window
+	{
+		if (pr->error != thermreg_error_OK) return;
+		pr->estc = 0;
+		pr->estT0 = pr->Tc;
+		pr->estPs = 0;
+		pr->estTs = 0;
+		return;
+	}
+	pr->estPs += pr->P;
+	pr->estTs += pr->Tc - pr->Ta;
+	if (++pr->estc >= pr->estw)
+	{
+		float tw = pr->dt * pr->ncycl * pr->estw; // window time [s]
+		thermreg_est_update(pr, pr->estPs / pr->estw, (pr->Tc - pr->estT0) / tw, pr->estTs / pr->estw);
+		pr->estc = 0; // next window starts here
+		pr->estT0 = pr->Tc;
+		pr->estPs = 0;
+		pr->estTs = 0;
+	}
+}
+
+void thermreg_est_init(thermreg_t* pr, float lam, int estw)
+{
+	pr->est = 1;
+	pr->lam = lam;
+	pr->estw = estw;
+	pr->estc = -1;      // window starts in next check cycle
+	pr->th[0] = pr->C;
+	pr->th[1] = 1 / pr->R;
+	pr->cov[0] = pr->C * pr->C; // initial uncertainty - same order as nominal values
+	pr->cov[1] = 0;
+	pr->cov[2] = 1 / (pr->R * pr->R);
+	pr->Pdae = 0;
+}
+
+void thermreg_leaky_init(thermreg_t* pr)
+{
+	pr->eleak = 1;
+	pr->ealpha = 2.0F / (pr->ebufl + 1);
+	thermreg_reset(pr);
+}
+
+void thermreg_decim_init(thermreg_t* pr, int pbufl, int pblk)
+{
+	pr->pbufl = pbufl;
+	pr->pblk = pblk;
+	thermreg_reset(pr);
+}
+
 void thermreg_check(thermreg_t* pr)
 {
 	if (++pr->cycl >= pr->ncycl)
 	{
-		if (pr->E == 0) // first pass - energy == 0 (cannot calculate energy increase)
-			pr->E = pr->C * pr->Tc; // current energy [J]
-		else
+		thermreg_check_cycle(pr);
+		pr->cycl = 0; // reset counter
+	}
+}
+
+void thermreg_check_cycle(thermreg_t* pr)
+{
+	if (pr->E == 0) // first pass - energy == 0 (cannot calculate energy increase)
+		pr->E = pr->C * pr->Tc; // current energy [J]
+	else
+	{
+		// calculate energy increase (dE [J]) from thermal capacity and current temperature
+		float E = pr->C * pr->Tc; // current energy [J]
+		float dE = E - pr->E; // energy increase
+		pr->E = E; // update energy
+		// calculate power from energy increase, temperature difference and thermal resistance
+		pr->Pc = (dE / (pr->dt * pr->ncycl)) + ((pr->Tc - pr->Ta) / pr->R); // calculated power
+		float Pd = pr->P - pr->Pc; // power difference between output power and calculated power
+		float* pbuff = THERMREG_PBUFF(pr); // power difference buffer
+		pr->pacc += Pd; // sum of current block
+		if (++pr->pblkc >= pr->pblk) // block complete?
 		{
-			// calculate energy increase (dE [J]) from thermal capacity and current temperature
-			float E = pr->C * pr->Tc; // current energy [J]
-			float dE = E - pr->E; // energy increase
-			pr->E = E; // update energy
-			// calculate power from energy increase, temperature difference and thermal resistance
-			pr->Pc = (dE / (pr->dt * pr->ncycl)) + ((pr->Tc - pr->Ta) / pr->R); // calculated power
-			float Pd = pr->P - pr->Pc; // power difference between output power and calculated power
-			// put average power difference value into ring buffer and calculate sum of all values in buffer (pbufs)
-			if (pr->pbufc < pr->pbufl) // power difference buffer is not full?
-				pr->pbufc++;  // increment count
-			else
-				pr->pbufs -= pr->pbuff[pr->pbufi]; // subtract old value from power difference buffer sum
-			pr->pbuff[pr->pbufi] = Pd; // put new value into buffer
-			pr->pbufs += Pd; // add new value to power difference buffer sum
-			pr->pbufi = (pr->pbufi + 1) % pr->pbufl; // increment index
-			pr->Pda = pr->pbufs / pr->pbufl; // average power difference [W]
-			if (pr->Pda <= pr->Pdnl)
-				pr->error = thermreg_error_PDNEGLIM;
-			else if (pr->Pda >= pr->Pdpl)
-				pr->error = thermreg_error_PDPOSLIM;
+			// put block sum into ring buffer and calculate sum of all values in buffer (pbufs)
+			thermreg_ring_push(pbuff, pr->pbufl, &pr->pbufi, &pr->pbufc, &pr->pbufs, &pr->pbufn, pr->pacc);
+			pr->pacc = 0;
+			pr->pblkc = 0;
 		}
-		pr->cycl = 0; // reset counter
+		// average power difference [W] - oldest block is counted by part remaining in window (pblk = 1: pbufs / pbufl)
+		float oldest = (pr->pbufc < pr->pbufl)?0:pbuff[pr->pbufi];
+		pr->Pda = (pr->pbufs - oldest * pr->pblkc / pr->pblk + pr->pacc) / (pr->pbufl * pr->pblk);
+		int supp = 0; // trip suppressed by estimated model
+		if (pr->est)
+		{
+			// power difference of estimated model, exponential average with time constant of window
+			float Pde = pr->P - (pr->th[0] * dE / (pr->C * pr->dt * pr->ncycl) + pr->th[1] * (pr->Tc - pr->Ta));
+			pr->Pdae += (Pde - pr->Pdae) * 2 / (pr->pbufl * pr->pblk + 1);
+			supp = (pr->Pdae > 0.5F * pr->Pdnl) && (pr->Pdae < 0.5F * pr->Pdpl);
+		}
+		if ((pr->Pda <= pr->Pdnl) && !supp)
+			pr->error = thermreg_error_PDNEGLIM;
+		else if ((pr->Pda >= pr->Pdpl) && !supp)
+			pr->error = thermreg_error_PDPOSLIM;
+		if (pr->est)
+			thermreg_est_cycle(pr);
 	}
 }
 
@@ -126,6 +287,7 @@ void thermreg_reset(thermreg_t* pr)
 	pr->Tt = 0;       // target temperature [K]
 	// reset error buffer
 	pr->ebufs = 0;    // sum of error buffer
+	pr->ebufn = 0;    // lap sum of error buffer
 	pr->ebufi = 0;    // index in error buffer
 	pr->ebufc = 0;    // count of samples in error buffer
 	// set output power to zero
@@ -134,19 +296,29 @@ void thermreg_reset(thermreg_t* pr)
 	pr->E = 0;        // current thermal energy of entire system [J]
 	// reset power difference buffer
 	pr->pbufs = 0;    // sum of power difference buffer
+	pr->pbufn = 0;    // lap sum of power difference buffer
 	pr->pbufi = 0;    // index in power difference buffer
 	pr->pbufc = 0;    // count of samples in power difference buffer
+	pr->pblkc = 0;    // count of check cycles in current block
+	pr->pacc = 0;     // sum of current block
+	pr->Pdae = 0;     // average power difference of estimated model
+	pr->estc = -1;    // discard estimation window
 	// reset error
 	pr->error = thermreg_error_OK; // regulator error (thermreg_error_t)
 }
 
-const char* _error_text[] = {"SENSOR_SHC", "SENSOR_OUT", "MINTEMP", "MAXTEMP", "PDNEGLIM", "PDPOSLIM" };
+const char* _error_text[] = {"OK", "SENSOR_SHC", "SENSOR_OUT", "MINTEMP", "MAXTEMP", "PDNEGLIM", "PDPOSLIM" };
 
 
 const char* thermreg_error_text(thermreg_t* pr)
 {
-	if ((pr->error >= thermreg_error_OK) && (pr->error <= thermreg_error_PDPOSLIM))
-		return _error_text[pr->error];
+	return thermreg_error_str(pr->error);
+}
+
+const char* thermreg_error_str(int error)
+{
+	if ((error >= thermreg_error_OK) && (error <= thermreg_error_PDPOSLIM))
+		return _error_text[error];
 	else
 		return "unknown";
 }
@@ -26,11 +26,13 @@ typedef struct
 	float kI;      // integration constant
 	float Tc;      // current temperature [K]
 	float Tt;      // target temperature [K]
-	float* ebuff;  // error buffer
-	float ebufs;   // sum of error buffer
+	float ebufs;   // sum of error buffer (replaced by lap sum ebufn at end of each lap - no drift)
+	float ebufn;   // sum of error buffer values written in current lap (one addition per push)
 	int ebufi;     // index in error buffer
 	int ebufc;     // count of samples in error buffer
-	int ebufl;     // length of error buffer
+	int ebufl;     // length of error buffer (leaky integrator - time constant in regulation periods)
+	int eleak;     // leaky integrator mode (no error buffer, ebufs is exponential sum, thermreg_leaky_init)
+	float ealpha;  // leaky integrator factor - 2 / (ebufl + 1)
 	float P;       // current output power [W]
 	// error checking
 	float Ta;      // ambient temperature [K]
@@ -44,26 +46,55 @@ typedef struct
 	float Pc;      // calculated output power [W]
 	int ncycl;     // number of regulator cycles per one error check cycle
 	int cycl;      // error check cycle counter
-	float* pbuff;  // power difference buffer
-	float pbufs;   // sum of power difference buffer
+	float pbufs;   // sum of power difference buffer (replaced by lap sum pbufn at end of each lap - no drift)
+	float pbufn;   // sum of power difference buffer values written in current lap (one addition per push)
 	int pbufi;     // index in power difference buffer
 	int pbufc;     // count of samples in power difference buffer
 	int pbufl;     // length of power difference buffer
+	int pblk;      // block length - check cycles summed into one power difference buffer value (1 = exact moving average)
+	int pblkc;     // count of check cycles in current block
+	float pacc;    // sum of power difference in current block
 	float Pdnl;    // negative power difference limit [W]
 	float Pdpl;    // positive power difference limit [W]
 	float Pda;     // average power difference [W]
 	int error;     // regulator error (thermreg_error_t)
+	// online estimation of C and R (optional, enabled by thermreg_est_init)
+	int est;       // estimation enabled
+	float lam;     // forgetting factor
+	int estw;      // estimation window (check cycles) - one estimate update per window
+	int estc;      // count of check cycles in current window (-1 = window discarded)
+	float estT0;   // temperature at start of window [K]
+	float estPs;   // sum of output power in window [W]
+	float estTs;   // sum of temperature difference Tc - Ta in window [K]
+	float th[2];   // estimated parameters - C [J/K], 1/R [W/K] (limited to C/4..4*C, 1/(4*R)..4/R)
+	float cov[3];  // covariance matrix of estimate (symmetric 2x2 - p11, p12, p22)
+	float Pdae;    // average power difference of estimated model [W] (exponential, time constant of window)
 } thermreg_t;
 
+// regulator buffers (error buffer and power difference buffer) are stored inline, directly after thermreg_t structure
+// regulator type with buffer capacity 'ebufn' and 'pbufn' is declared with THERMREG_DEFINE, for example:
+//   THERMREG_DEFINE(myreg_t, 90, 200);
+//   myreg_t reg;
+//   thermreg_init(&reg.reg, ...);
+// whole regulator state is one contiguous block - it can be copied (memcpy, assignment) and reset without heap
+#define THERMREG_DEFINE(type, ebufn, pbufn) typedef struct { thermreg_t reg; float buff[(ebufn) + (pbufn)]; } type
+
+// size of regulator with buffer capacity 'ebufn' and 'pbufn' (for caller allocated storage)
+#define THERMREG_SIZE(ebufn, pbufn) (sizeof(thermreg_t) + ((ebufn) + (pbufn)) * sizeof(float))
+
+// number of stored error buffer values (0 in leaky integrator mode)
+#define THERMREG_EBUFN(pr) ((pr)->eleak?0:(pr)->ebufl)
+
+// error buffer and power difference buffer of regulator
+#define THERMREG_EBUFF(pr) ((float*)((pr) + 1))
+#define THERMREG_PBUFF(pr) (THERMREG_EBUFF(pr) + THERMREG_EBUFN(pr))
+
 
 // initialize all member variables and do thermreg_reset
 // all function parameters corresponds to members in thermreg_t structure, Pmin is set to zero (can be changed after init)
-// buffers ebuff and pbuff are allocated using malloc
+// 'pr' must point to regulator declared with THERMREG_DEFINE with capacity at least 'ebufl' and 'pbufl' (no allocation)
 extern void thermreg_init(thermreg_t* pr, float dt, float Pmax, float kP, float kI, int ebufl, float Tmin, float Tmax, float Tss, float Tso, float C, float R, int ncycl, int pbufl, float Pdnl, float Pdpl);
 
-// free allocated buffers
-extern void thermreg_done(thermreg_t* pr);
-
 // set input temperature and do limit check, set "error" member variable in case when value Tc excess any limit (Tmin, Tmax, Tss, Tso)
 // this function should be called before each call of thermreg_cycle with fresh temperature value
 extern void thermreg_input(thermreg_t* pr, float Tc);
@@ -77,6 +108,27 @@ extern void thermreg_cycle(thermreg_t* pr);
 // this function must be called after each call of thermreg_cycle
 extern void thermreg_check(thermreg_t* pr);
 
+// do one error check cycle without cycle counter - for check scheduled with its own period of 'ncycl' regulation periods
+// (tsched.h), thermreg_check calls it at every 'ncycl'-th call
+extern void thermreg_check_cycle(thermreg_t* pr);
+
+// enable online estimation of C and R - RLS with forgetting factor 'lam' (e.g. 0.8) on averages over 'estw' check cycles,
+// O(1) per check cycle, frozen while error is set or window is beyond half of limits (fault is not learned)
+// estimated model only suppresses trips of nominal check while its own Pdae stays within half of limits
+extern void thermreg_est_init(thermreg_t* pr, float lam, int estw);
+
+// switch integration part to leaky integrator - O(1) state, error buffer is not used (regulator can be declared with ebufn = 0)
+// ebufs += a * (ebufl * err - ebufs), a = 2 / (ebufl + 1) - ebufs / ebufl is exponential average of error with the same
+// mean delay as sliding window of ebufl samples, so the same kI and ebufl give equivalent closed loop
+// anti-windup clamp for kI > 0 only - ebufs keeps output before limiting within Pmin..Pmax
+// must be called after thermreg_init (power difference buffer moves to start of buffer space), regulator is reset
+extern void thermreg_leaky_init(thermreg_t* pr);
+
+// decimating averager of power difference check - 'pbufl' block sums of 'pblk' check cycles, window pbufl * pblk check
+// cycles in memory of pbufl values, Pda differs from exact moving average by at most dPd / (4 * pbufl) (dPd = range of Pd
+// within oldest block), 'pbufl' must not exceed buffer capacity, regulator is reset
+extern void thermreg_decim_init(thermreg_t* pr, int pbufl, int pblk);
+
 // reset internal control variables, empty buffers, regulation and output power checking starts from beginning
 // this function must be called to clear "error" member variable
 extern void thermreg_reset(thermreg_t* pr);
@@ -84,5 +136,8 @@ extern void thermreg_reset(thermreg_t* pr);
 
 extern const char* thermreg_error_text(thermreg_t* pr);
 
+// return text for error code (thermreg_error_t)
+extern const char* thermreg_error_str(int error);
+
 
 #endif // _THERMREG_H
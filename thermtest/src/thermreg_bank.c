@@ -0,0 +1,270 @@
+// thermreg_bank.c
+
+#include "thermreg_bank.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// number of per-lane arrays in allocated block (24 float arrays + error)
+#define _BANK_LANE_ARRAYS 25
+
+
+int thermreg_bank_init(thermreg_bank_t* pb, int n, thermreg_t* pr)
+{
+	memset(pb, 0, sizeof(thermreg_bank_t));
+	if (pr->est) // online estimation has no lanes
+		return -1;
+	int nl = SIMD_LANES(n);
+	size_t size = (size_t)nl * (_BANK_LANE_ARRAYS + THERMREG_EBUFN(pr) + pr->pbufl) * sizeof(float);
+	float* p = SIMD_MALLOC(size); // allocate aligned memory block
+	if (p == 0)
+		return -1;
+	memset(p, 0, size);
+	pb->mem = p;
+	pb->n = n;                  // number of regulators
+	pb->nl = nl;                // number of lanes
+	pb->dt = pr->dt;            // regulation period [s]
+	pb->ebufl = pr->ebufl;      // length of error buffer
+	pb->eleak = pr->eleak;      // leaky integrator mode
+	pb->ealpha = pr->ealpha;    // leaky integrator factor
+	pb->ncycl = pr->ncycl;      // number of regulator cycles per one error check cycle
+	pb->pbufl = pr->pbufl;      // length of power difference buffer
+	pb->pblk = pr->pblk;        // block length of decimating averager
+	// distribute memory block
+	pb->Pmin = p; p += nl;
+	pb->Pmax = p; p += nl;
+	pb->kP = p; p += nl;
+	pb->kI = p; p += nl;
+	pb->Tc = p; p += nl;
+	pb->Tt = p; p += nl;
+	pb->ebufs = p; p += nl;
+	pb->ebufn = p; p += nl;
+	pb->P = p; p += nl;
+	pb->Ta = p; p += nl;
+	pb->Tmin = p; p += nl;
+	pb->Tmax = p; p += nl;
+	pb->Tss = p; p += nl;
+	pb->Tso = p; p += nl;
+	pb->C = p; p += nl;
+	pb->R = p; p += nl;
+	pb->E = p; p += nl;
+	pb->Pc = p; p += nl;
+	pb->pbufs = p; p += nl;
+	pb->pbufn = p; p += nl;
+	pb->pacc = p; p += nl;
+	pb->Pdnl = p; p += nl;
+	pb->Pdpl = p; p += nl;
+	pb->Pda = p; p += nl;
+	pb->error = (int*)p; p += nl;
+	pb->ebuff = p; p += nl * THERMREG_EBUFN(pr);
+	pb->pbuff = p;
+	// copy parameters from template regulator into all lanes (including padding lanes)
+	int l; for (l = 0; l < nl; l++)
+	{
+		pb->Pmin[l] = pr->Pmin;
+		pb->Pmax[l] = pr->Pmax;
+		pb->kP[l] = pr->kP;
+		pb->kI[l] = pr->kI;
+		pb->Ta[l] = pr->Ta;
+		pb->Tmin[l] = pr->Tmin;
+		pb->Tmax[l] = pr->Tmax;
+		pb->Tss[l] = pr->Tss;
+		pb->Tso[l] = pr->Tso;
+		pb->C[l] = pr->C;
+		pb->R[l] = pr->R;
+		pb->Pdnl[l] = pr->Pdnl;
+		pb->Pdpl[l] = pr->Pdpl;
+	}
+	thermreg_bank_reset(pb);
+	return 0;
+}
+
+void thermreg_bank_done(thermreg_bank_t* pb)
+{
+	if (pb->mem)
+		SIMD_FREE(pb->mem); // free aligned memory block
+	pb->mem = 0;
+}
+
+void thermreg_bank_input(thermreg_bank_t* pb, const float* Tc)
+{
+	memcpy(pb->Tc, Tc, pb->n * sizeof(float)); // update current temperature variables
+	int l; for (l = 0; l < pb->nl; l += SIMD_WIDTH)
+	{
+		vf_t tc = VLD(pb->Tc + l);
+		vf_t tss = VLD(pb->Tss + l);
+		vf_t tso = VLD(pb->Tso + l);
+		vf_t tmax = VLD(pb->Tmax + l);
+		vi_t e = VILD(pb->error + l);
+		// check for sensor short circuit and sensor out error, direction depends on (Tss > Tmax)
+		vf_t inv = VGT(tss, tmax);
+		e = VISEL(VSEL(inv, VLE(tc, tss), VGE(tc, tss)), e, thermreg_error_SENSOR_SHC);
+		e = VISEL(VSEL(inv, VGE(tc, tso), VLE(tc, tso)), e, thermreg_error_SENSOR_OUT);
+		// check for maxtemp and mintemp error
+		vf_t mmax = VGT(tc, tmax);
+		e = VISEL(mmax, e, thermreg_error_MAXTEMP);
+		e = VISEL(VANDN(VLT(tc, VLD(pb->Tmin + l)), mmax), e, thermreg_error_MINTEMP);
+		VIST(pb->error + l, e);
+	}
+}
+
+
+void thermreg_bank_cycle(thermreg_bank_t* pb)
+{
+	int full = (pb->ebufc >= pb->ebufl); // error buffer is full?
+	float* ebuff = pb->ebuff + pb->ebufi * pb->nl; // current row in interleaved error buffer
+	vf_t ebufl = VSET((float)pb->ebufl);
+	vf_t zero = VSET(0.0F);
+	vf_t ealpha = VSET(pb->ealpha);
+	int lap = (pb->ebufi + 1 >= pb->ebufl); // end of lap - lap sums replace running sums
+	int l; for (l = 0; l < pb->nl; l += SIMD_WIDTH)
+	{
+		// calculate regulation
+		vf_t err = VSUB(VLD(pb->Tt + l), VLD(pb->Tc + l)); // regulation error
+		// put error value into ring buffer and calculate sum of all values in buffer (ebufs)
+		vf_t ebufs = VLD(pb->ebufs + l);
+		if (pb->eleak)
+		{
+			// leaky integrator, anti-windup limit (same as thermreg_cycle)
+			ebufs = VADD(ebufs, VMUL(ealpha, VSUB(VMUL(err, ebufl), ebufs)));
+			vf_t ki = VLD(pb->kI + l);
+			vf_t noaw = VLE(ki, zero); // no anti-windup (kI <= 0, bounds of masked lanes are not used)
+			vf_t pp = VMUL(err, VLD(pb->kP + l)); // proportional part
+			vf_t emin = VDIV(VMUL(VSUB(VLD(pb->Pmin + l), pp), ebufl), ki);
+			vf_t emax = VDIV(VMUL(VSUB(VLD(pb->Pmax + l), pp), ebufl), ki);
+			ebufs = VSEL(VANDN(VGT(ebufs, emax), noaw), ebufs, emax);
+			ebufs = VSEL(VANDN(VLT(ebufs, emin), noaw), ebufs, emin);
+		}
+		else
+		{
+			if (full)
+				ebufs = VSUB(ebufs, VLD(ebuff + l)); // subtract old value from error buffer sum
+			VST(ebuff + l, err); // put new value into buffer
+			ebufs = VADD(ebufs, err); // add new value to error buffer sum
+			vf_t ebufn = VADD(VLD(pb->ebufn + l), err); // add new value to lap sum (same as thermreg_ring_push)
+			if (lap)
+			{
+				ebufs = ebufn; // end of lap - lap sum replaces running sum
+				ebufn = zero;
+			}
+			VST(pb->ebufn + l, ebufn);
+		}
+		VST(pb->ebufs + l, ebufs);
+		// calculate output power
+		vf_t out = VADD(VMUL(err, VLD(pb->kP + l)), VDIV(VMUL(ebufs, VLD(pb->kI + l)), ebufl));
+		// limit output power
+		vf_t pmin = VLD(pb->Pmin + l);
+		vf_t pmax = VLD(pb->Pmax + l);
+		out = VSEL(VLT(out, pmin), out, pmin);
+		out = VSEL(VGT(out, pmax), out, pmax);
+		// set output power only in case of no error
+		VST(pb->P + l, VSEL(VIOK(VILD(pb->error + l)), zero, out));
+	}
+	if (!full)
+		pb->ebufc++;  // increment count
+	if (++pb->ebufi >= pb->ebufl) // increment index
+		pb->ebufi = 0;
+}
+
+void thermreg_bank_check(thermreg_bank_t* pb)
+{
+	if (++pb->cycl >= pb->ncycl)
+	{
+		int l;
+		if (!pb->epass) // first pass - energy not valid (cannot calculate energy increase)
+		{
+			for (l = 0; l < pb->nl; l += SIMD_WIDTH)
+				VST(pb->E + l, VMUL(VLD(pb->C + l), VLD(pb->Tc + l))); // current energy [J]
+			pb->epass = 1;
+		}
+		else
+		{
+			int full = (pb->pbufc >= pb->pbufl); // power difference buffer is full?
+			int push = (pb->pblkc + 1 >= pb->pblk); // block complete?
+			float* pbuff = pb->pbuff + pb->pbufi * pb->nl; // current row in interleaved power difference buffer
+			// index and count after this cycle - oldest block is counted by part remaining in window (0 while buffer is not full)
+			int wi = pb->pbufi;
+			int wc = pb->pbufc;
+			if (push)
+			{
+				if (!full) wc++;
+				if (++wi >= pb->pbufl) wi = 0;
+			}
+			float* pold = pb->pbuff + wi * pb->nl; // oldest block
+			int ofull = (wc >= pb->pbufl);
+			vf_t zero = VSET(0.0F);
+			vf_t dtn = VSET(pb->dt * pb->ncycl);
+			vf_t wlen = VSET((float)(pb->pbufl * pb->pblk));
+			vf_t pblkc = VSET((float)(push?0:(pb->pblkc + 1)));
+			vf_t pblk = VSET((float)pb->pblk);
+			for (l = 0; l < pb->nl; l += SIMD_WIDTH)
+			{
+				// calculate energy increase (dE [J]) from thermal capacity and current temperature
+				vf_t tc = VLD(pb->Tc + l);
+				vf_t E = VMUL(VLD(pb->C + l), tc); // current energy [J]
+				vf_t dE = VSUB(E, VLD(pb->E + l)); // energy increase
+				VST(pb->E + l, E); // update energy
+				// calculate power from energy increase, temperature difference and thermal resistance
+				vf_t Pc = VADD(VDIV(dE, dtn), VDIV(VSUB(tc, VLD(pb->Ta + l)), VLD(pb->R + l))); // calculated power
+				VST(pb->Pc + l, Pc);
+				vf_t Pd = VSUB(VLD(pb->P + l), Pc); // power difference between output power and calculated power
+				vf_t pacc = VADD(VLD(pb->pacc + l), Pd); // sum of current block
+				vf_t pbufs = VLD(pb->pbufs + l);
+				if (push)
+				{
+					// put block sum into ring buffer and calculate sum of all values in buffer (pbufs)
+					if (full)
+						pbufs = VSUB(pbufs, VLD(pbuff + l)); // subtract old value from power difference buffer sum
+					VST(pbuff + l, pacc); // put new value into buffer
+					pbufs = VADD(pbufs, pacc); // add new value to power difference buffer sum
+					vf_t pbufn = VADD(VLD(pb->pbufn + l), pacc); // add new value to lap sum
+					if (wi == 0) // end of lap - lap sum replaces running sum
+					{
+						pbufs = pbufn;
+						pbufn = zero;
+					}
+					VST(pb->pbufn + l, pbufn);
+					VST(pb->pbufs + l, pbufs);
+					pacc = zero;
+				}
+				VST(pb->pacc + l, pacc);
+				vf_t oldest = ofull?VLD(pold + l):zero;
+				vf_t Pda = VDIV(VADD(VSUB(pbufs, VDIV(VMUL(oldest, pblkc), pblk)), pacc), wlen); // average power difference [W]
+				VST(pb->Pda + l, Pda);
+				vi_t e = VILD(pb->error + l);
+				vf_t mneg = VLE(Pda, VLD(pb->Pdnl + l));
+				e = VISEL(mneg, e, thermreg_error_PDNEGLIM);
+				e = VISEL(VANDN(VGE(Pda, VLD(pb->Pdpl + l)), mneg), e, thermreg_error_PDPOSLIM);
+				VIST(pb->error + l, e);
+			}
+			pb->pbufi = wi; // index in power difference buffer
+			pb->pbufc = wc; // count of values in power difference buffer
+			pb->pblkc = push?0:(pb->pblkc + 1); // count of check cycles in current block
+		}
+		pb->cycl = 0; // reset counter
+	}
+}
+
+void thermreg_bank_reset(thermreg_bank_t* pb)
+{
+	int l; for (l = 0; l < pb->nl; l++)
+	{
+		pb->Tt[l] = 0;       // target temperature [K]
+		pb->ebufs[l] = 0;    // sum of error buffer
+		pb->ebufn[l] = 0;    // lap sum of error buffer
+		pb->P[l] = 0;        // current output power [W]
+		pb->E[l] = 0;        // current thermal energy of entire system [J]
+		pb->pbufs[l] = 0;    // sum of power difference buffer
+		pb->pbufn[l] = 0;    // lap sum of power difference buffer
+		pb->pacc[l] = 0;     // sum of current block
+		pb->error[l] = thermreg_error_OK; // regulator error (thermreg_error_t)
+	}
+	// reset error buffer
+	pb->ebufi = 0;    // index in error buffer
+	pb->ebufc = 0;    // count of samples in error buffer
+	// reset power difference buffer
+	pb->epass = 0;    // first error check pass
+	pb->pbufi = 0;    // index in power difference buffer
+	pb->pbufc = 0;    // count of samples in power difference buffer
+	pb->pblkc = 0;    // count of check cycles in current block
+}
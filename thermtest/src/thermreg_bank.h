@@ -0,0 +1,93 @@
+// thermreg_bank.h
+// bank of N regulators in structure-of-arrays layout, stepped together with SSE/AVX lanes
+// each lane behaves exactly like one thermreg_t (same operations in the same order, bit for bit equal results)
+
+#ifndef _THERMREG_BANK_H
+#define _THERMREG_BANK_H
+
+#include "thermreg.h"
+#include "simd.h"
+
+// number of lanes processed by one vector operation, lane count is padded to multiple of this value
+#define THERMREG_BANK_WIDTH SIMD_WIDTH
+
+
+// regulator bank structure
+// all per-lane arrays have 'nl' elements and are aligned to THERMREG_BANK_WIDTH floats
+// ring buffers are interleaved - value 'i' of lane 'l' is at index i * nl + l
+// buffer lengths, periods and indexes are shared by all lanes (whole bank is stepped and reset together)
+typedef struct
+{
+	int n;         // number of regulators
+	int nl;        // number of lanes (n rounded up to THERMREG_BANK_WIDTH)
+	// regulation
+	float dt;      // regulation period [s]
+	float* Pmin;   // minimum output power [W]
+	float* Pmax;   // maximum output power [W]
+	float* kP;     // proportional constant
+	float* kI;     // integration constant
+	float* Tc;     // current temperature [K]
+	float* Tt;     // target temperature [K]
+	float* ebuff;  // error buffer (interleaved, ebufl * nl, not allocated in leaky integrator mode)
+	float* ebufs;  // sum of error buffer
+	float* ebufn;  // lap sum of error buffer (replaces ebufs at end of lap, same as thermreg_t)
+	int ebufi;     // index in error buffer
+	int ebufc;     // count of samples in error buffer
+	int ebufl;     // length of error buffer
+	int eleak;     // leaky integrator mode (same as thermreg_leaky_init)
+	float ealpha;  // leaky integrator factor
+	float* P;      // current output power [W]
+	// error checking
+	float* Ta;     // ambient temperature [K]
+	float* Tmin;   // temperature limit for mintemp error [K]
+	float* Tmax;   // temperature limit for maxtemp error [K]
+	float* Tss;    // temperature limit for sensor short circuit error [K]
+	float* Tso;    // temperature limit for sensor out error [K]
+	float* C;      // thermal capacity of entire system [J/K]
+	float* R;      // thermal resistance between entire system and ambient [K/W]
+	float* E;      // current thermal energy of entire system [J]
+	float* Pc;     // calculated output power [W]
+	int ncycl;     // number of regulator cycles per one error check cycle
+	int cycl;      // error check cycle counter
+	int epass;     // first error check pass done (energy valid)
+	float* pbuff;  // power difference buffer (interleaved, pbufl * nl) - block sums
+	float* pbufs;  // sum of power difference buffer
+	float* pbufn;  // lap sum of power difference buffer (replaces pbufs at end of lap)
+	int pbufi;     // index in power difference buffer
+	int pbufc;     // count of samples in power difference buffer
+	int pbufl;     // length of power difference buffer
+	int pblk;      // block length of decimating averager (same as thermreg_decim_init)
+	int pblkc;     // count of check cycles in current block
+	float* pacc;   // sum of power difference in current block
+	float* Pdnl;   // negative power difference limit [W]
+	float* Pdpl;   // positive power difference limit [W]
+	float* Pda;    // average power difference [W]
+	int* error;    // regulator error (thermreg_error_t)
+	void* mem;     // allocated memory block
+} thermreg_bank_t;
+
+
+// allocate bank of 'n' regulators, all lanes are initialized from template regulator 'pr' (like thermreg_init) and reset
+// leaky integrator mode and decimating averager block length of template are used for all lanes
+// per-lane parameters (Pmin, Pmax, kP, kI, Ta, Tmin, Tmax, Tss, Tso, C, R, Pdnl, Pdpl) can be changed after init
+// online estimation (thermreg_est_init) is not supported - returns -1 for estimating template
+// returns 0 on success, -1 when allocation fails
+extern int thermreg_bank_init(thermreg_bank_t* pb, int n, thermreg_t* pr);
+
+// free allocated memory
+extern void thermreg_bank_done(thermreg_bank_t* pb);
+
+// set input temperatures (array of 'n' values) and do limit check for all lanes, same as thermreg_input
+extern void thermreg_bank_input(thermreg_bank_t* pb, const float* Tc);
+
+// do regulation cycle for all lanes, same as thermreg_cycle
+extern void thermreg_bank_cycle(thermreg_bank_t* pb);
+
+// check output power vs temperature change for all lanes, same as thermreg_check
+extern void thermreg_bank_check(thermreg_bank_t* pb);
+
+// reset all lanes, same as thermreg_reset
+extern void thermreg_bank_reset(thermreg_bank_t* pb);
+
+
+#endif // _THERMREG_BANK_H
@@ -0,0 +1,224 @@
+// trace.c
+
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+#define _0C 273.15F
+
+static const char* _col_names[TRACE_COLS] = {"t", "Tc", "P", "Pc", "Pda", "error", "T", "Th", "Ts"};
+
+
+// block size [bytes]
+static size_t trace_block_size(uint32_t block)
+{
+	return TRACE_BLOCK_HEADER_SIZE + (size_t)block * TRACE_COLS * 4;
+}
+
+static void trace_flush(trace_writer_t* pw)
+{
+	if (pw->rows == 0) return;
+	pw->buff[0] = pw->rows; // block header - number of valid rows
+	if (pw->rows < pw->block) // partial block - clear unused values
+	{
+		int c; for (c = 0; c < TRACE_COLS; c++)
+			memset(pw->buff + TRACE_BLOCK_HEADER_SIZE / 4 + c * pw->block + pw->rows, 0, (pw->block - pw->rows) * 4);
+	}
+	if (fwrite(pw->buff, trace_block_size(pw->block), 1, pw->f) != 1)
+		pw->werr = 1;
+	pw->rows = 0;
+}
+
+int trace_create(trace_writer_t* pw, const char* filename, uint32_t block, float dt)
+{
+	memset(pw, 0, sizeof(trace_writer_t));
+	pw->block = block?block:TRACE_BLOCK;
+	pw->f = fopen(filename, "wb");
+	if (pw->f == 0)
+		return -1;
+	pw->buff = calloc(1, trace_block_size(pw->block));
+	if (pw->buff == 0)
+	{
+		fclose(pw->f);
+		pw->f = 0;
+		return -1;
+	}
+	// header
+	uint8_t hdr[TRACE_HEADER_SIZE];
+	memset(hdr, 0, sizeof(hdr));
+	uint16_t version = TRACE_VERSION;
+	uint16_t ncols = TRACE_COLS;
+	memcpy(hdr + 0, "THTR", 4);
+	memcpy(hdr + 4, &version, 2);
+	memcpy(hdr + 6, &ncols, 2);
+	memcpy(hdr + 8, &pw->block, 4);
+	memcpy(hdr + 12, &dt, 4);
+	int c; for (c = 0; c < TRACE_COLS; c++)
+		strncpy((char*)hdr + 16 + c * 8, _col_names[c], 8);
+	if (fwrite(hdr, sizeof(hdr), 1, pw->f) != 1)
+	{
+		trace_close(pw);
+		return -1;
+	}
+	return 0;
+}
+
+void trace_write(trace_writer_t* pw, const trace_sample_t* ps)
+{
+	uint32_t* col = pw->buff + TRACE_BLOCK_HEADER_SIZE / 4 + pw->rows; // first column, current row
+	memcpy(col + trace_col_t * pw->block, &ps->t, 4);
+	memcpy(col + trace_col_Tc * pw->block, &ps->Tc, 4);
+	memcpy(col + trace_col_P * pw->block, &ps->P, 4);
+	memcpy(col + trace_col_Pc * pw->block, &ps->Pc, 4);
+	memcpy(col + trace_col_Pda * pw->block, &ps->Pda, 4);
+	memcpy(col + trace_col_error * pw->block, &ps->error, 4);
+	memcpy(col + trace_col_T * pw->block, &ps->T, 4);
+	memcpy(col + trace_col_Th * pw->block, &ps->Th, 4);
+	memcpy(col + trace_col_Ts * pw->block, &ps->Ts, 4);
+	pw->total++;
+	if (++pw->rows >= pw->block)
+		trace_flush(pw);
+}
+
+int trace_close(trace_writer_t* pw)
+{
+	if (pw->f == 0) return -1;
+	trace_flush(pw);
+	if (fclose(pw->f) != 0)
+		pw->werr = 1;
+	free(pw->buff);
+	pw->f = 0;
+	pw->buff = 0;
+	return pw->werr?-1:0;
+}
+
+
+int trace_map(trace_reader_t* pr, const char* filename)
+{
+	memset(pr, 0, sizeof(trace_reader_t));
+#ifdef _WIN32
+	HANDLE hf = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (hf == INVALID_HANDLE_VALUE) return -1;
+	LARGE_INTEGER size;
+	GetFileSizeEx(hf, &size);
+	pr->size = (size_t)size.QuadPart;
+	HANDLE hm = (pr->size > 0)?CreateFileMappingA(hf, 0, PAGE_READONLY, 0, 0, 0):0;
+	CloseHandle(hf);
+	if (hm == 0) return -1;
+	pr->data = MapViewOfFile(hm, FILE_MAP_READ, 0, 0, 0);
+	pr->handle = hm;
+	if (pr->data == 0)
+	{
+		CloseHandle(hm);
+		return -1;
+	}
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return -1;
+	struct stat st;
+	if ((fstat(fd, &st) < 0) || (st.st_size == 0))
+	{
+		close(fd);
+		return -1;
+	}
+	pr->size = st.st_size;
+	void* p = mmap(0, pr->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) return -1;
+	pr->data = p;
+#endif
+	return 0;
+}
+
+int trace_open(trace_reader_t* pr, const char* filename)
+{
+	if (trace_map(pr, filename) < 0)
+		return -1;
+	if (trace_header(pr) < 0)
+	{
+		trace_done(pr);
+		return -1;
+	}
+	return 0;
+}
+
+int trace_header(trace_reader_t* pr)
+{
+	if (pr->size < TRACE_HEADER_SIZE)
+		return -1;
+	// check header
+	uint16_t version, ncols;
+	memcpy(&version, pr->data + 4, 2);
+	memcpy(&ncols, pr->data + 6, 2);
+	memcpy(&pr->block, pr->data + 8, 4);
+	memcpy(&pr->dt, pr->data + 12, 4);
+	if ((memcmp(pr->data, "THTR", 4) != 0) || (version != TRACE_VERSION) || (ncols != TRACE_COLS) || (pr->block == 0))
+		return -1;
+	pr->nblocks = (pr->size - TRACE_HEADER_SIZE) / trace_block_size(pr->block);
+	if (pr->nblocks > 0)
+	{
+		uint32_t last;
+		memcpy(&last, pr->data + TRACE_HEADER_SIZE + (pr->nblocks - 1) * trace_block_size(pr->block), 4);
+		if (last > pr->block) // corrupted block header
+			return -1;
+		pr->rows = (uint64_t)(pr->nblocks - 1) * pr->block + last;
+	}
+	return 0;
+}
+
+void trace_done(trace_reader_t* pr)
+{
+	if (pr->data == 0) return;
+#ifdef _WIN32
+	UnmapViewOfFile(pr->data);
+	CloseHandle(pr->handle);
+#else
+	munmap((void*)pr->data, pr->size);
+#endif
+	pr->data = 0;
+}
+
+const float* trace_column(const trace_reader_t* pr, uint32_t b, int col, uint32_t* nrows)
+{
+	const uint8_t* pb = pr->data + TRACE_HEADER_SIZE + b * trace_block_size(pr->block);
+	memcpy(nrows, pb, 4);
+	if (*nrows > pr->block) // corrupted block header - never read past the block
+		*nrows = pr->block;
+	return (const float*)(pb + TRACE_BLOCK_HEADER_SIZE + (size_t)col * pr->block * 4);
+}
+
+const char* trace_column_name(int col)
+{
+	return ((col >= 0) && (col < TRACE_COLS))?_col_names[col]:"unknown";
+}
+
+long trace_to_tsv(const char* filename, FILE* out)
+{
+	trace_reader_t rd;
+	if (trace_open(&rd, filename) < 0)
+		return -1;
+	uint32_t b, i, n;
+	for (b = 0; b < rd.nblocks; b++)
+	{
+		const float* t = trace_column(&rd, b, trace_col_t, &n);
+		const float* Tc = trace_column(&rd, b, trace_col_Tc, &n);
+		const float* P = trace_column(&rd, b, trace_col_P, &n);
+		const float* Pc = trace_column(&rd, b, trace_col_Pc, &n);
+		const float* Pda = trace_column(&rd, b, trace_col_Pda, &n);
+		const int32_t* error = (const int32_t*)trace_column(&rd, b, trace_col_error, &n);
+		for (i = 0; i < n; i++)
+			fprintf(out, "%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%d\n", t[i], Tc[i] - _0C, P[i], Pc[i], P[i] - Pc[i], Pda[i], error[i]?1:0);
+	}
+	long rows = (long)rd.rows;
+	trace_done(&rd);
+	return rows;
+}
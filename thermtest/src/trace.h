@@ -0,0 +1,119 @@
+// trace.h
+// binary columnar trace files - writer, memory-mapped reader and converter to legacy TSV output
+//
+// file layout (native byte order of writer - files are read on machine of the same endianness):
+//   header   96 bytes - magic "THTR", version, number of columns, rows per block, time step, column names
+//   blocks   16 bytes block header (row count) followed by columns, each column has 'block' values of 4 bytes
+// all blocks have the same size (last block is padded), so any block can be addressed directly
+// columns are float except 'error' which is int32
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+// trace file version
+#define TRACE_VERSION 1
+
+// default number of rows per block
+#define TRACE_BLOCK 1024
+
+// trace header size [bytes]
+#define TRACE_HEADER_SIZE 96
+
+// trace block header size [bytes]
+#define TRACE_BLOCK_HEADER_SIZE 16
+
+
+// trace columns
+typedef enum
+{
+	trace_col_t = 0,      // time [s]
+	trace_col_Tc = 1,     // regulator input temperature [K]
+	trace_col_P = 2,      // regulator output power [W]
+	trace_col_Pc = 3,     // calculated power [W]
+	trace_col_Pda = 4,    // average power difference [W]
+	trace_col_error = 5,  // regulator error (int32)
+	trace_col_T = 6,      // simulated heat block temperature [K]
+	trace_col_Th = 7,     // simulated heater temperature [K]
+	trace_col_Ts = 8,     // simulated sensor temperature [K]
+	TRACE_COLS = 9,       // number of columns
+} trace_column_t;
+
+// one trace row
+typedef struct
+{
+	float t;        // time [s]
+	float Tc;       // regulator input temperature [K]
+	float P;        // regulator output power [W]
+	float Pc;       // calculated power [W]
+	float Pda;      // average power difference [W]
+	int32_t error;  // regulator error
+	float T;        // simulated heat block temperature [K]
+	float Th;       // simulated heater temperature [K]
+	float Ts;       // simulated sensor temperature [K]
+} trace_sample_t;
+
+// trace writer
+typedef struct
+{
+	FILE* f;         // output file
+	uint32_t block;  // rows per block
+	uint32_t rows;   // rows in current block
+	uint32_t* buff;  // block buffer (header + columns)
+	uint64_t total;  // total number of written rows
+	int werr;        // write error (fwrite failed), reported by trace_close
+} trace_writer_t;
+
+// trace reader (memory mapped file)
+typedef struct
+{
+	const uint8_t* data; // mapped file data
+	size_t size;         // file size [bytes]
+	uint32_t block;      // rows per block
+	uint32_t nblocks;    // number of blocks
+	uint64_t rows;       // total number of rows
+	float dt;            // time step [s]
+	void* handle;        // mapping handle (windows)
+} trace_reader_t;
+
+
+// create trace file, 'block' = rows per block (0 = TRACE_BLOCK), 'dt' is informative time step stored in header
+// returns 0 on success, -1 on error
+extern int trace_create(trace_writer_t* pw, const char* filename, uint32_t block, float dt);
+
+// append one row, full blocks are written to file
+extern void trace_write(trace_writer_t* pw, const trace_sample_t* ps);
+
+// write last (partial) block and close file, returns 0 on success, -1 when any write failed
+extern int trace_close(trace_writer_t* pw);
+
+
+// open and memory map trace file, returns 0 on success, -1 on error (also when row count of last block exceeds block size)
+extern int trace_open(trace_reader_t* pr, const char* filename);
+
+// memory map any file read-only without header check (only data, size and handle are set), unmapped by trace_done
+// returns 0 on success, -1 on error (empty file cannot be mapped)
+extern int trace_map(trace_reader_t* pr, const char* filename);
+
+// check header of file mapped by trace_map and set block, nblocks, rows and dt (trace_open without second mapping)
+// returns 0 on success, -1 when file is not valid trace (mapping is kept, caller calls trace_done)
+extern int trace_header(trace_reader_t* pr);
+
+// unmap and close trace file
+extern void trace_done(trace_reader_t* pr);
+
+// return pointer to column 'col' of block 'b' directly in mapped memory (zero copy), 'nrows' is set to number of valid rows
+// (row count of corrupted block header is clamped to block size, 'b' must be less than nblocks)
+// values are float except trace_col_error (int32_t)
+extern const float* trace_column(const trace_reader_t* pr, uint32_t b, int col, uint32_t* nrows);
+
+// return column name
+extern const char* trace_column_name(int col);
+
+// convert trace to legacy TSV layout (t, Tc[C], P, Pc, P-Pc, Pda, error?1:0), returns number of rows or -1 on error
+extern long trace_to_tsv(const char* filename, FILE* out);
+
+
+#endif // _TRACE_H
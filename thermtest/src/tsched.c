@@ -0,0 +1,66 @@
+// tsched.c
+
+#include "tsched.h"
+#include <string.h>
+
+
+void sched_init(sched_t* ps, float dt)
+{
+	memset(ps, 0, sizeof(sched_t));
+	ps->dt = dt;
+}
+
+int sched_add(sched_t* ps, const char* name, sched_func_t* func, void* arg, uint32_t period, uint32_t phase)
+{
+	if ((ps->ntasks >= SCHED_MAX_TASKS) || (period == 0))
+		return -1;
+	sched_task_t* pt = &ps->tasks[ps->ntasks];
+	pt->func = func;
+	pt->arg = arg;
+	pt->period = period;
+	pt->phase = phase;
+	pt->next = (phase > ps->tick)?phase:(ps->tick + (period - (ps->tick - phase) % period) % period); // first due tick from now
+	pt->runs = 0;
+	pt->name = name;
+	return ps->ntasks++;
+}
+
+uint32_t sched_run(sched_t* ps, uint32_t nticks)
+{
+	uint32_t end = ps->tick + nticks;
+	uint32_t n = 0;
+	ps->stop = 0;
+	while ((ps->tick != end) && !ps->stop)
+	{
+		int i; for (i = 0; i < ps->ntasks; i++)
+		{
+			sched_task_t* pt = &ps->tasks[i];
+			if (pt->next == ps->tick)
+			{
+				pt->func(pt->arg, ps->tick);
+				pt->next += pt->period;
+				pt->runs++;
+			}
+		}
+		ps->tick++;
+		n++;
+	}
+	return n;
+}
+
+void sched_stop(sched_t* ps)
+{
+	ps->stop = 1;
+}
+
+void sched_skip(sched_t* ps, uint32_t nticks)
+{
+	ps->tick += nticks;
+	int i; for (i = 0; i < ps->ntasks; i++)
+		ps->tasks[i].next += nticks;
+}
+
+float sched_time(const sched_t* ps, uint32_t tick)
+{
+	return tick * ps->dt;
+}
@@ -0,0 +1,62 @@
+// tsched.h
+// multi-rate co-simulation scheduler - tasks with own period and phase in one deterministic loop
+// time is integer tick count (time = tick * dt, no float accumulation), tasks due in the same tick run in registration order
+// (not sched.h - it would shadow system <sched.h> included by pthread.h and rt.c)
+
+#ifndef _TSCHED_H
+#define _TSCHED_H
+
+#include <inttypes.h>
+
+// maximum number of tasks
+#define SCHED_MAX_TASKS 16
+
+
+// task function, 'tick' is current tick number
+typedef void (sched_func_t)(void* arg, uint32_t tick);
+
+// task
+typedef struct
+{
+	sched_func_t* func; // task function
+	void* arg;          // task argument
+	uint32_t period;    // period [ticks]
+	uint32_t phase;     // first tick (task runs at ticks phase + i * period)
+	uint32_t next;      // next tick to run
+	uint32_t runs;      // number of runs (cpu load statistics)
+	const char* name;   // task name
+} sched_task_t;
+
+// scheduler
+typedef struct
+{
+	float dt;           // tick period [s]
+	uint32_t tick;      // current tick
+	int ntasks;         // number of tasks
+	int stop;           // stop request (set by sched_stop)
+	sched_task_t tasks[SCHED_MAX_TASKS]; // tasks in registration (execution) order
+} sched_t;
+
+
+// initialize scheduler with tick period 'dt' [s], current tick is 0 (can be set before tasks are added - run continues
+// from checkpoint, phases stay relative to tick 0)
+extern void sched_init(sched_t* ps, float dt);
+
+// register task running every 'period' ticks starting at tick 'phase', returns task index or -1 when table is full
+extern int sched_add(sched_t* ps, const char* name, sched_func_t* func, void* arg, uint32_t period, uint32_t phase);
+
+// run 'nticks' ticks (or until sched_stop is called), returns number of executed ticks
+extern uint32_t sched_run(sched_t* ps, uint32_t nticks);
+
+// stop sched_run after current tick (can be called from task)
+extern void sched_stop(sched_t* ps);
+
+// skip 'nticks' ticks after current tick - time and next tick of all tasks move forward (can be called from task,
+// remaining tasks of current tick run), 'nticks' should be multiple of all task periods to keep phases
+extern void sched_skip(sched_t* ps, uint32_t nticks);
+
+// return time of tick [s]
+extern float sched_time(const sched_t* ps, uint32_t tick);
+
+
+#endif // _TSCHED_H
@@ -0,0 +1,156 @@
+// tune.c
+
+#include "tune.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pool.h"
+
+
+typedef struct
+{
+	const tune_param_t* pc;
+	tune_eval_t* eval;
+	void* arg;
+	tune_result_t* pres;
+	const int* idx;    // candidate indices of stage
+	float horizon;     // simulated time of stage [s]
+	int stage;         // stage number
+} tune_job_t;
+
+static void tune_job(int i, void* arg)
+{
+	tune_job_t* pj = (tune_job_t*)arg;
+	int c = pj->idx[i];
+	pj->eval(&pj->pc[c], pj->horizon, &pj->pres[c], pj->arg);
+	pj->pres[c].stage = pj->stage;
+}
+
+// order of candidate indices by score (insertion sort, stage 2 results first)
+static void tune_sort(int* idx, int count, const tune_result_t* pres)
+{
+	int i, j;
+	for (i = 1; i < count; i++)
+		for (j = i; j > 0; j--)
+		{
+			const tune_result_t* pa = &pres[idx[j - 1]];
+			const tune_result_t* pb = &pres[idx[j]];
+			if ((pa->stage > pb->stage) || ((pa->stage == pb->stage) && (pa->score <= pb->score)))
+				break;
+			int t = idx[j]; idx[j] = idx[j - 1]; idx[j - 1] = t;
+		}
+}
+
+
+void tune_meas_init(tune_meas_t* pm, float Ta, float Tt, float horizon)
+{
+	memset(pm, 0, sizeof(tune_meas_t));
+	pm->Ta = Ta;
+	pm->Tt = Tt;
+	pm->horizon = horizon;
+	pm->Trmin = 1e9F;
+	pm->Trmax = -1e9F;
+	pm->res.rise = -1;
+}
+
+int tune_meas_sample(tune_meas_t* pm, float t, float T)
+{
+	tune_result_t* pr = &pm->res;
+	if ((pr->rise < 0) && (T - pm->Ta >= 0.9F * (pm->Tt - pm->Ta)))
+		pr->rise = t;
+	if (T - pm->Tt > pr->overshoot)
+		pr->overshoot = T - pm->Tt;
+	if ((pm->ns < TUNE_SAMPLES) && (t >= pm->ns * pm->horizon / TUNE_SAMPLES))
+		pm->T[pm->ns++] = T;
+	if (t >= 0.75F * pm->horizon) // ripple window
+	{
+		if (T < pm->Trmin) pm->Trmin = T;
+		if (T > pm->Trmax) pm->Trmax = T;
+		pm->Trsum += T;
+		pm->nr++;
+	}
+	if (pr->overshoot > TUNE_OS_LIMIT) return 1;
+	if ((pr->rise < 0) && (t > 0.5F * pm->horizon)) return 1;
+	return 0;
+}
+
+void tune_meas_done(tune_meas_t* pm, int stopped, tune_result_t* pres)
+{
+	tune_result_t* pr = &pm->res;
+	pr->ripple = (pm->nr > 0)?(pm->Trmax - pm->Trmin):0;
+	float Tf = (pm->nr > 0)?(pm->Trsum / pm->nr):pm->Tt; // final temperature
+	pr->offset = fabsf(Tf - pm->Tt);
+	// settling time - last stored sample outside of band around final temperature
+	int i; for (i = pm->ns - 1; i >= 0; i--)
+		if (fabsf(pm->T[i] - Tf) > TUNE_BAND)
+			break;
+	pr->settle = (i + 1) * pm->horizon / TUNE_SAMPLES;
+	if (stopped || (pr->rise < 0))
+		pr->score = TUNE_SCORE_FAIL;
+	else
+		pr->score = pr->rise + pr->settle + 4 * pr->overshoot + 20 * pr->ripple + 10 * pr->offset;
+	pr->stage = pres->stage;
+	*pres = *pr;
+}
+
+int tune_grid(tune_param_t* pc, int max, float kPmin, float kPmax, int nkP, float kImin, float kImax, int nkI, const int* ebufl, int nebufl)
+{
+	int count = 0;
+	int i, j, k;
+	for (i = 0; i < nkP; i++)
+		for (j = 0; j < nkI; j++)
+			for (k = 0; k < nebufl; k++)
+			{
+				if (count >= max) return count;
+				pc[count].kP = kPmin * powf(kPmax / kPmin, (nkP > 1)?((float)i / (nkP - 1)):0);
+				pc[count].kI = kImin * powf(kImax / kImin, (nkI > 1)?((float)j / (nkI - 1)):0);
+				pc[count].ebufl = ebufl[k];
+				count++;
+			}
+	return count;
+}
+
+int tune_run(const tune_param_t* pc, int count, tune_eval_t* eval, void* arg, tune_result_t* pres, int nthreads)
+{
+	int* idx = malloc(count * sizeof(int));
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		idx[i] = i;
+		pres[i].stage = 0;
+	}
+	// stage 1 - all candidates, short horizon
+	tune_job_t job = {pc, eval, arg, pres, idx, TUNE_HORIZON1, 1};
+	pool_run(count, tune_job, &job, nthreads);
+	tune_sort(idx, count, pres);
+	// stage 2 - best quarter (stopped candidates excluded), full horizon
+	int n2 = (count + 3) / 4;
+	while ((n2 > 1) && (pres[idx[n2 - 1]].score >= TUNE_SCORE_FAIL)) n2--;
+	job.horizon = TUNE_HORIZON2;
+	job.stage = 2;
+	pool_run(n2, tune_job, &job, nthreads);
+	tune_sort(idx, count, pres);
+	int best = idx[0];
+	free(idx);
+	return best;
+}
+
+void tune_print(FILE* out, const tune_param_t* pc, const tune_result_t* pres, int count, int top)
+{
+	int* idx = malloc(count * sizeof(int));
+	int i;
+	for (i = 0; i < count; i++) idx[i] = i;
+	tune_sort(idx, count, pres);
+	fprintf(out, "%8s %8s %6s %8s %10s %8s %8s %8s %10s\n", "kP", "kI", "ebufl", "rise", "overshoot", "settle", "ripple", "offset", "score");
+	for (i = 0; (i < top) && (i < count); i++)
+	{
+		const tune_param_t* pp = &pc[idx[i]];
+		const tune_result_t* pr = &pres[idx[i]];
+		fprintf(out, "%8.2f %8.2f %6d %8.2f %10.2f %8.2f %8.3f %8.2f ", pp->kP, pp->kI, pp->ebufl, pr->rise, pr->overshoot, pr->settle, pr->ripple, pr->offset);
+		if (pr->score < TUNE_SCORE_FAIL)
+			fprintf(out, "%10.2f%s\n", pr->score, (pr->stage < 2)?" (stage 1)":"");
+		else
+			fprintf(out, "%10s\n", "stopped");
+	}
+	free(idx);
+}
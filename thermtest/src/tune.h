@@ -0,0 +1,86 @@
+// tune.h
+// parallel PI gain autotuner - grid search with successive halving, candidates scored on simulated step response
+// regulator and plant are provided by evaluation callback (float thermreg_t in thermtest, thermreg_avr_t in thermtest_avr)
+
+#ifndef _TUNE_H
+#define _TUNE_H
+
+#include <stdio.h>
+
+// simulated time of first stage (all candidates) and second stage (best quarter) [s]
+#define TUNE_HORIZON1 120
+#define TUNE_HORIZON2 300
+
+// settling band [K]
+#define TUNE_BAND 1.0F
+
+// overshoot limit [K] - candidate is stopped immediately when exceeded
+#define TUNE_OS_LIMIT 15.0F
+
+// number of stored samples of step response (for settling time relative to final temperature)
+#define TUNE_SAMPLES 1024
+
+// score of stopped candidate
+#define TUNE_SCORE_FAIL 1e9F
+
+
+// candidate parameters (float domain - output power [W] = kP * err + kI * average of error buffer)
+typedef struct
+{
+	float kP;      // proportional constant [W/K]
+	float kI;      // integration constant [W/K] (negative)
+	int ebufl;     // length of error buffer (regulator cycles)
+} tune_param_t;
+
+// candidate metrics, measured on sensor temperature of step response from ambient to target
+typedef struct
+{
+	float rise;      // rise time to 90% of step [s]
+	float overshoot; // maximum temperature above target [K]
+	float settle;    // settling time - last time outside of TUNE_BAND around final temperature [s]
+	float ripple;    // peak to peak temperature in last quarter of horizon [K]
+	float offset;    // steady state error - absolute difference of final (average) temperature and target [K]
+	float score;     // rise + settle + 4 * overshoot + 20 * ripple + 10 * offset (lower is better), TUNE_SCORE_FAIL = stopped
+	int stage;       // last evaluated stage (1 or 2)
+} tune_result_t;
+
+// step response measurement
+typedef struct
+{
+	float Ta;        // start temperature [K]
+	float Tt;        // target temperature [K]
+	float horizon;   // simulated time [s]
+	float Trmin;     // minimum temperature in ripple window [K]
+	float Trmax;     // maximum temperature in ripple window [K]
+	float Trsum;     // sum of temperatures in ripple window [K]
+	int nr;          // number of samples in ripple window
+	int ns;          // number of stored samples
+	float T[TUNE_SAMPLES]; // stored samples, one per horizon / TUNE_SAMPLES
+	tune_result_t res; // metrics
+} tune_meas_t;
+
+// evaluation callback - simulate closed loop with parameters 'pp' for 'horizon' seconds, fill metrics using tune_meas_t
+typedef void (tune_eval_t)(const tune_param_t* pp, float horizon, tune_result_t* pres, void* arg);
+
+
+// initialize step response measurement from 'Ta' to 'Tt' [K] for 'horizon' seconds
+extern void tune_meas_init(tune_meas_t* pm, float Ta, float Tt, float horizon);
+
+// add sample 'T' [K] at time 't' [s], returns nonzero when candidate should be stopped (overshoot limit, no rise in half of horizon)
+extern int tune_meas_sample(tune_meas_t* pm, float t, float T);
+
+// finish measurement, 'stopped' = candidate was stopped by tune_meas_sample, copy metrics to 'pres'
+extern void tune_meas_done(tune_meas_t* pm, int stopped, tune_result_t* pres);
+
+// fill grid of candidates - geometric steps of kP and kI, listed error buffer lengths, returns number of candidates
+extern int tune_grid(tune_param_t* pc, int max, float kPmin, float kPmax, int nkP, float kImin, float kImax, int nkI, const int* ebufl, int nebufl);
+
+// evaluate 'count' candidates on 'nthreads' threads (0 = all cpu cores) - all for TUNE_HORIZON1, best quarter for TUNE_HORIZON2
+// returns index of best candidate
+extern int tune_run(const tune_param_t* pc, int count, tune_eval_t* eval, void* arg, tune_result_t* pres, int nthreads);
+
+// print 'top' best candidates (header and lines)
+extern void tune_print(FILE* out, const tune_param_t* pc, const tune_result_t* pres, int count, int top);
+
+
+#endif // _TUNE_H
@@ -0,0 +1,109 @@
+// bench_avr.c
+// cycle benchmark of AVR regulator - runs on target (simavr), cycles are counted by Timer1 with prescaler 1
+// input temperatures are recorded regulator inputs of thermtest_avr trace (bench_input.h, generated by Makefile)
+// results are printed to UART0, simavr exits when cpu sleeps with interrupts disabled
+// on hold - not built or run yet, no measured results exist, see status in Makefile
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include "thermreg_avr.h"
+#include "bench_input.h"
+
+
+#define BAUD 38400
+
+// regulator - same constants as thermtest_avr (main_avr.c)
+#define EBUFL 22
+#define PBUFL 125
+#define SHRE 5
+#define SHRO 3
+THERMREG_AVR_DEFINE(reg_t, EBUFL, PBUFL);
+reg_t regb;
+
+// cycle statistics of one function
+typedef struct
+{
+	const char* name;  // function name
+	uint16_t min;      // minimum cycles per call
+	uint16_t max;      // maximum cycles per call
+	uint32_t sum;      // sum of cycles (average = sum / calls)
+	uint16_t calls;    // number of calls
+} bench_stat_t;
+
+bench_stat_t stats[3] = {{"thermreg_avr_input_float", 0xffff}, {"thermreg_avr_cycle_isr", 0xffff}, {"thermreg_avr_check", 0xffff}};
+uint16_t ovh; // measurement overhead (two reads of TCNT1)
+
+
+static int uart_putchar(char c, FILE* f)
+{
+	if (c == '\n') uart_putchar('\r', f);
+	loop_until_bit_is_set(UCSR0A, UDRE0);
+	UDR0 = c;
+	return 0;
+}
+
+static FILE uart = FDEV_SETUP_STREAM(uart_putchar, 0, _FDEV_SETUP_WRITE);
+
+static void bench_add(bench_stat_t* ps, uint16_t cycles)
+{
+	cycles -= ovh;
+	if (cycles < ps->min) ps->min = cycles;
+	if (cycles > ps->max) ps->max = cycles;
+	ps->sum += cycles;
+	ps->calls++;
+}
+
+// ISR body - not inlined, call and return are part of measured cycles (as from timer interrupt)
+static void __attribute__((noinline)) bench_cycle_isr(thermreg_avr_t* pr)
+{
+	thermreg_avr_cycle_isr(pr, SHRE, SHRO);
+}
+
+int main(void)
+{
+	UBRR0 = F_CPU / 16 / BAUD - 1;
+	UCSR0B = _BV(TXEN0);
+	stdout = &uart;
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10); // Timer1 - cpu clock, no prescaler
+	uint16_t t0 = TCNT1;
+	ovh = TCNT1 - t0;
+	// regulator initialization (same as init in main_avr.c)
+	thermreg_avr_t* pr = &regb.reg;
+	pr->kP = 150;
+	pr->kIneg = 199;
+	pr->ebufl = EBUFL;
+	pr->shre = SHRE;
+	pr->shro = SHRO;
+	thermreg_avr_check_init(pr, 9.0F, 24.5F, 38.0F, 0.04F, 20.0F, 4, PBUFL, -15.0F, 15.0F);
+	thermreg_avr_reset(pr);
+	pr->Tt = 250 * THERMREG_AVR_TMUL;
+	pr->Tc = 20 * THERMREG_AVR_TMUL;
+	uint16_t i; for (i = 0; i < BENCH_INPUTS; i++)
+	{
+		float Tc = pgm_read_float(&bench_input[i]);
+		cli();
+		t0 = TCNT1;
+		thermreg_avr_input_float(pr, Tc);
+		bench_add(&stats[0], TCNT1 - t0);
+		t0 = TCNT1;
+		bench_cycle_isr(pr);
+		bench_add(&stats[1], TCNT1 - t0);
+		t0 = TCNT1;
+		thermreg_avr_check(pr);
+		bench_add(&stats[2], TCNT1 - t0);
+		sei();
+	}
+	// print results (function calls min avg max), footprint of regulator in RAM
+	printf("bench %s %luHz, %u inputs, regulator %u bytes + buffers %u bytes\n", BENCH_MCU, (unsigned long)F_CPU, BENCH_INPUTS, (unsigned)sizeof(thermreg_avr_t), (unsigned)(sizeof(reg_t) - sizeof(thermreg_avr_t)));
+	uint8_t j; for (j = 0; j < 3; j++)
+		printf("%-26s %6u %6u %6lu %6u\n", stats[j].name, stats[j].calls, stats[j].min, (unsigned long)(stats[j].sum / stats[j].calls), stats[j].max);
+	cli();
+	sleep_enable();
+	sleep_cpu(); // simavr exits
+	return 0;
+}
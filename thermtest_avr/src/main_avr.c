@@ -2,81 +2,455 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <math.h>
-#include <conio.h>
 #include "thermreg_avr.h"
+#include "thermreg.h"
 #include "sim_nozzle.h"
+#include "trace.h"
+#include "thermrec_avr.h"
+#include "tsched.h"
+#include "tune.h"
+#include "ntc.h"
 
 
 
-void test0(void); // 0 - target temperature = 250C, OK
+// 0 - target temperature = 250C, OK
+// 1 - target temperature = 250C, heater disconnected while heating (30s after start)
+// 2 - target temperature = 250C, heater disconnected at stable temperature (100s after start)
+// 3 - target temperature = 250C, thermistor failure at stable temperature (100s after start), shows 240C
+// 4 - target temperature = 250C, thermistor failure at stable temperature (100s after start), shows 260C
+#define TESTS 5
 
+// error expected in each test (heater failure - positive limit, thermistor failure 240C - positive limit, 260C - negative limit)
+const int test_error[TESTS] = {thermreg_avr_error_OK, thermreg_avr_error_PDPOSLIM, thermreg_avr_error_PDPOSLIM, thermreg_avr_error_PDPOSLIM, thermreg_avr_error_PDNEGLIM};
+
+// test result - detection of fixed point check and float reference check
+typedef struct
+{
+	int error;      // first error of thermreg_avr_check
+	float terror;   // detection time [s] (-1 = no error)
+	int error_ref;  // first error of float reference check
+	float terror_ref; // detection time of float reference check [s] (-1 = no error)
+} result_t;
+
+void test(int n, trace_writer_t* ptw, result_t* pres);
 
-sim_nozzle_t sim;
 
-thermreg_avr_t reg;
-int16_t ebuff[22];
+sim_nozzle_t sim;  // plant of tested loop
+sim_nozzle_t simr; // plant of reference loop
+
+#define EBUFL 22  // length of error buffer
+#define SHRE 5    // right shift of ebufs * kI (constant for thermreg_avr_cycle_isr)
+#define SHRO 3    // right shift of output
+#define PBUFL 125 // length of power difference buffer
+THERMREG_AVR_DEFINE(reg_t, EBUFL, PBUFL);
+reg_t regb; // regulator with inline buffers
+reg_t regr; // regulator of reference loop - copy of regb, thermreg_avr_check is not called (output is never cut off)
+thermrec_avr_t rec;
+thermrec_avr_sample_t rec_buff[64];
+sched_t sched;
+int est = 0; // online estimation of kE and kL (-e)
+int raw = 0; // raw ADC input path - thermistor model and NTC table (-r)
+int leaky = 0; // leaky integrator instead of error buffer (-l)
+int shb = 0;   // decimating averager, block of 2^shb check cycles (-b shb)
+ntc_t ntc;   // thermistor model
 
 #define _0C 273.15F
 
 
 #define SIM_DT  0.01
 #define SIM_MUL 4
+#define SIM_TICKS 50000 // number of simulation steps (500s)
+
+// power check parameters (same model constants and window as thermtest, check period 4 * 0.04s, window 125 * 0.16s = 20s)
+#define CHK_C     9.0F    // thermal capacity of entire system [J/K]
+#define CHK_R     24.5F   // thermal resistance between entire system and ambient [K/W]
+#define CHK_PMAX  38.0F   // maximum output power [W]
+#define CHK_TA    20.0F   // ambient temperature [C]
+#define CHK_NCYCL 4       // number of regulator cycles per one error check cycle
+#define CHK_PBUFL PBUFL // length of power difference buffer
+#define CHK_PDNL  -15.0F  // negative power difference limit [W]
+#define CHK_PDPL  15.0F   // positive power difference limit [W]
+
+// test tasks - index in task_name and task_period, tasks due in the same tick run in this order
+enum { TASK_PLANT, TASK_SENSOR, TASK_REGULATOR, TASK_CHECK, TASK_RECORDER, TASK_HEATER, TASK_MONITOR, TASK_TRACE, TASK_COUNT };
+const char* task_name[TASK_COUNT] = {"plant", "sensor", "regulator", "check", "recorder", "heater", "monitor", "trace"};
+// task periods [ticks of SIM_DT] - can be changed with -p name=ticks (sample rate / cpu load trade-offs)
+// check constants follow check period, window is CHK_PBUFL check periods, regulator gains are tuned for SIM_MUL
+uint32_t task_period[TASK_COUNT] = {1, SIM_MUL, SIM_MUL, SIM_MUL * CHK_NCYCL, SIM_MUL, 1, 1, 1};
+
+
+// float reference of power difference check - thermreg_check of thermtest with the same constants and window
+// reference runs on its own copy of the loop (regr, simr), identical with tested loop until thermreg_avr_check trips
+// and cuts off output, then reference loop keeps regulating - reference detection does not depend on tested check
+THERMREG_DEFINE(ref_t, 0, PBUFL);
+ref_t ref;
+
+
+// regulator type for autotune candidates (error buffer up to 255 samples)
+THERMREG_AVR_DEFINE(tune_reg_t, 255, PBUFL);
 
+// autotune candidate - heat-up from ambient to 250C, fixed point regulator with gains encoded by thermreg_avr_gains_init
+// local regulator and simulator (called from worker threads), regulator every SIM_MUL simulation steps as in test
+void tune_eval(const tune_param_t* pp, float horizon, tune_result_t* pres, void* arg)
+{
+	(void)arg; // no shared context - each candidate is self-contained
+	tune_reg_t treg;
+	thermreg_avr_t* pr = &treg.reg;
+	sim_nozzle_t ts;
+	memset(&treg, 0, sizeof(treg));
+	pr->Tc = 20 * THERMREG_AVR_TMUL;
+	pr->ebufl = pp->ebufl;
+	thermreg_avr_gains_init(pr, pp->kP, pp->kI, CHK_PMAX);
+	thermreg_avr_check_init(pr, CHK_C, CHK_R, CHK_PMAX, SIM_DT * SIM_MUL, CHK_TA, CHK_NCYCL, CHK_PBUFL, CHK_PDNL, CHK_PDPL);
+	thermreg_avr_reset(pr);
+	pr->Tt = 250 * THERMREG_AVR_TMUL;
+	sim_nozzle_init(&ts);
+	tune_meas_t meas;
+	tune_meas_init(&meas, ts.Ts, 250 + _0C, horizon);
+	int stopped = 0;
+	int k, ticks = (int)(horizon / SIM_DT + 0.5F);
+	for (k = 0; (k < ticks) && !stopped; k++)
+	{
+		sim_nozzle_cycle(&ts, SIM_DT);
+		if ((k % SIM_MUL) == 0)
+		{
+			thermreg_avr_input_float(pr, ts.Ts - _0C);
+			thermreg_avr_cycle(pr);
+			thermreg_avr_check(pr);
+		}
+		ts.P = pr->P * CHK_PMAX / 255;
+		stopped = tune_meas_sample(&meas, k * (float)SIM_DT, ts.Ts);
+	}
+	tune_meas_done(&meas, stopped, pres);
+}
+
+// compare thermreg_avr_cycle_isr with thermreg_avr_cycle - the same inputs for 'n' cycles in error buffer and leaky
+// integrator mode, inputs near target with full range steps (limits of output and leaky update), random error flag
+// returns number of cycles with different state (output, error buffer, sum)
+int isr_test(int n)
+{
+	static reg_t ra, rb;
+	int mode, fails = 0;
+	for (mode = 0; mode < 2; mode++)
+	{
+		memset(&ra, 0, sizeof(ra));
+		ra.reg.kP = 150;
+		ra.reg.kIneg = 199;
+		ra.reg.ebufl = EBUFL;
+		ra.reg.shre = SHRE;
+		ra.reg.shro = SHRO;
+		thermreg_avr_check_init(&ra.reg, CHK_C, CHK_R, CHK_PMAX, SIM_DT * SIM_MUL, CHK_TA, CHK_NCYCL, CHK_PBUFL, CHK_PDNL, CHK_PDPL);
+		if (mode)
+			thermreg_avr_leaky_init(&ra.reg);
+		thermreg_avr_reset(&ra.reg);
+		rb = ra;
+		uint32_t x = 2463534242u; // xorshift32 state
+		int k; for (k = 0; k < n; k++)
+		{
+			x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+			int16_t Tt = (int16_t)(250 * THERMREG_AVR_TMUL);
+			int16_t Tc = ((x & 7) == 0)?(int16_t)(x >> 16):(int16_t)(Tt + (int16_t)((x >> 8) & 0xff) - 128);
+			int8_t error = ((x >> 24) & 63)?thermreg_avr_error_OK:thermreg_avr_error_PDNEGLIM;
+			ra.reg.Tt = rb.reg.Tt = Tt;
+			ra.reg.Tc = rb.reg.Tc = Tc;
+			ra.reg.error = rb.reg.error = error;
+			thermreg_avr_cycle(&ra.reg);
+			thermreg_avr_cycle_isr(&rb.reg, SHRE, SHRO);
+			if (memcmp(&ra, &rb, sizeof(ra)) != 0)
+			{
+				fails++;
+				rb = ra; // continue from the same state
+			}
+		}
+	}
+	return fails;
+}
 
 int main(int argc, char**argv)
 {
-	reg.kP = 150;         // proportional constant
-	reg.kIneg = 199;      // integration constant
-	reg.Tc = 20 * THERMREG_AVR_TMUL;     // current temperature [C] * THERMREG_AVR_TMUL
-//	reg.Tt = 0;           // target temperature [C]
-	reg.ebuff = ebuff;    // error buffer
-//	reg.ebufs = 0;        // sum of error buffer
-//	reg.ebufi = 0;        // index in error buffer
-//	reg.ebufc = 0;        // count of samples in error buffer
-	reg.ebufl = sizeof(ebuff)/sizeof(ebuff[0]);  // length of error buffer
-//	reg.P = 0;            // current output power (0-255 = 0-100% of maximum power)
-	reg.shre = 5;         // right shift of ebufs * kI
-	reg.shro = 3;         // right shift of output
-	thermreg_avr_reset(&reg);
+	if ((argc > 1) && (strcmp(argv[1], "tune") == 0))
+	{
+		// autotune - float gains searched in parallel, each candidate runs with its fixed point encoding
+		static const int ebufl[] = {10, 22, 40, 60, 100};
+		static tune_param_t cand[8 * 8 * 5];
+		static tune_result_t res[8 * 8 * 5];
+		int count = tune_grid(cand, 8 * 8 * 5, 10, 120, 8, -5, -160, 8, ebufl, 5);
+		int best = tune_run(cand, count, tune_eval, 0, res, (argc > 2)?atoi(argv[2]):0);
+		printf("autotune: %d candidates (kP, kI [W/K] before fixed point encoding)\n", count);
+		tune_print(stdout, cand, res, count, 10);
+		thermreg_avr_t r;
+		memset(&r, 0, sizeof(r));
+		r.ebufl = cand[best].ebufl;
+		thermreg_avr_gains_init(&r, cand[best].kP, cand[best].kI, CHK_PMAX);
+		float kP, kI;
+		thermreg_avr_gains(&r, CHK_PMAX, &kP, &kI);
+		printf("recommended: kP=%d kIneg=%d shre=%d shro=%d ebufl=%d (kP=%.2f kI=%.2f W/K)\n", r.kP, r.kIneg, r.shre, r.shro, r.ebufl, kP, kI);
+		return 0;
+	}
+	if ((argc > 2) && (strcmp(argv[1], "tsv") == 0))
+	{
+		// convert binary trace to TSV
+		if (trace_to_tsv(argv[2], stdout) < 0)
+		{
+			fprintf(stderr, "cannot read trace file '%s'\n", argv[2]);
+			return 1;
+		}
+		return 0;
+	}
+	ntc_init(&ntc);
+	if ((argc > 1) && (strcmp(argv[1], "ntctable") == 0))
+	{
+		// generate NTC lookup table source (thermreg_avr_ntc.c)
+		float err = ntc_table_write(&ntc, stdout, THERMREG_AVR_NTC_SHIFT, -20, 320);
+		fprintf(stderr, "maximum interpolation error %.2f C\n", err);
+		return 0;
+	}
+	while ((argc > 1) && (argv[1][0] == '-'))
+	{
+		if (strcmp(argv[1], "-e") == 0)
+			est = 1; // online estimation of kE and kL in tests
+		else if (strcmp(argv[1], "-r") == 0)
+			raw = 1; // raw ADC input path in tests
+		else if (strcmp(argv[1], "-l") == 0)
+			leaky = 1; // leaky integrator in tests
+		else if ((strcmp(argv[1], "-b") == 0) && (argc > 2))
+		{
+			shb = atoi(argv[2]); // decimating averager in tests
+			argc--;
+			argv++;
+		}
+		else if ((strcmp(argv[1], "-p") == 0) && (argc > 2))
+		{
+			// task period in tests (name=ticks, e.g. check=32)
+			const char* eq = strchr(argv[2], '=');
+			int j; for (j = 0; j < TASK_COUNT; j++)
+				if (eq && (strncmp(argv[2], task_name[j], eq - argv[2]) == 0) && (task_name[j][eq - argv[2]] == 0))
+					break;
+			if ((j == TASK_COUNT) || (atoi(eq + 1) <= 0))
+			{
+				fprintf(stderr, "invalid task period '%s' (name=ticks, tasks: plant sensor regulator check recorder heater monitor trace)\n", argv[2]);
+				return 1;
+			}
+			task_period[j] = atoi(eq + 1);
+			argc--;
+			argv++;
+		}
+		else
+			break;
+		argc--;
+		argv++;
+	}
+	result_t res;
+	if (argc > 1)
+	{
+		// single test with trace and flight recorder output
+		int n = atoi(argv[1]);
+		const char* output = (argc > 2)?argv[2]:"test.trc";
+		trace_writer_t tw;
+		if (trace_create(&tw, output, 0, SIM_DT) < 0)
+		{
+			fprintf(stderr, "cannot create trace file '%s'\n", output);
+			return 1;
+		}
+		test(n, &tw, &res);
+		if (trace_close(&tw) < 0)
+			fprintf(stderr, "cannot write trace file '%s'\n", output);
+		printf("test%d: error %d at %.2f s (float reference: error %d at %.2f s)\n", n, res.error, res.terror, res.error_ref, res.terror_ref);
+		// print flight recorder window (cycle Tc P Pc ebufs pbufs error)
+		uint8_t i; for (i = 0; i < thermrec_avr_count(&rec); i++)
+		{
+			const thermrec_avr_sample_t* ps = thermrec_avr_get(&rec, i);
+			printf("%d\t%.2f\t%d\t%d\t%ld\t%ld\t%d\n", (int16_t)(ps->cycle - rec.trig), (double)ps->Tc / THERMREG_AVR_TMUL, ps->P, ps->Pc, (long)ps->ebufs, (long)ps->pbufs, ps->error);
+		}
+		// print scheduler statistics (task period, number of runs)
+		int j; for (j = 0; j < sched.ntasks; j++)
+			fprintf(stderr, "%-10s period %5.2f ms  runs %lu\n", sched.tasks[j].name, sched.tasks[j].period * SIM_DT * 1000, (unsigned long)sched.tasks[j].runs);
+		return 0;
+	}
+	// all tests, compare detection of fixed point check with float reference
+	int n, fail = 0;
+	printf("test  error  t_detect  error_ref  t_detect_ref  difference\n");
+	for (n = 0; n < TESTS; n++)
+	{
+		test(n, 0, &res);
+		float diff = ((res.terror >= 0) && (res.terror_ref >= 0))?(res.terror - res.terror_ref):0;
+		printf("%4d  %5d  %8.2f  %9d  %12.2f  %10.2f\n", n, res.error, res.terror, res.error_ref, res.terror_ref, diff);
+		// tolerance - same error and detection time within 2 check periods, expected error (fault missed by both fails)
+		if ((res.error != res.error_ref) || (fabsf(diff) > 2 * SIM_DT * task_period[TASK_CHECK] + 0.001F) || (res.error != test_error[n]))
+			fail = 1;
+	}
+	// hot path variant of regulation cycle must give identical results
+	int isr_fails = isr_test(1000000);
+	printf("thermreg_avr_cycle_isr vs thermreg_avr_cycle: 2 x 1000000 cycles, %d different\n", isr_fails);
+	if (isr_fails)
+		fail = 1;
+	return fail;
+}
+
 
+void init(void)
+{
+	memset(&regb, 0, sizeof(regb));
+	regb.reg.kP = 150;         // proportional constant
+	regb.reg.kIneg = 199;      // integration constant
+	regb.reg.Tc = 20 * THERMREG_AVR_TMUL;     // current temperature [C] * THERMREG_AVR_TMUL
+//	regb.reg.Tt = 0;           // target temperature [C]
+//	regb.reg.ebufs = 0;        // sum of error buffer
+//	regb.reg.ebufi = 0;        // index in error buffer
+//	regb.reg.ebufc = 0;        // count of samples in error buffer
+	regb.reg.ebufl = EBUFL;    // length of error buffer
+//	regb.reg.P = 0;            // current output power (0-255 = 0-100% of maximum power)
+	regb.reg.shre = SHRE;      // right shift of ebufs * kI
+	regb.reg.shro = SHRO;      // right shift of output
+	// check has its own task period (thermreg_avr_check_cycle), constants for one check cycle
+	thermreg_avr_check_init(&regb.reg, CHK_C, CHK_R, CHK_PMAX, SIM_DT * task_period[TASK_CHECK], CHK_TA, 1, CHK_PBUFL, CHK_PDNL, CHK_PDPL);
+	if (leaky)
+		thermreg_avr_leaky_init(&regb.reg); // same time constant as error buffer (EBUFL cycles)
+	if (shb)
+		thermreg_avr_decim_init(&regb.reg, (CHK_PBUFL + (1 << shb) / 2) >> shb, shb); // about the same window, fewer values
+	if (est)
+		thermreg_avr_est_init(&regb.reg, 250, 5); // window 32 check cycles (5.12s)
+	thermreg_avr_reset(&regb.reg);
+	thermrec_avr_init(&rec, &regb.reg, rec_buff, sizeof(rec_buff)/sizeof(rec_buff[0]), 40, 20);
 	sim_nozzle_init(&sim);
+	// reference loop and float check (nominal constants, the same window as thermreg_avr_check)
+	regr = regb;
+	simr = sim;
+	memset(&ref, 0, sizeof(ref));
+	thermreg_init(&ref.reg, SIM_DT * task_period[TASK_CHECK], CHK_PMAX, 0, 0, 0, 0, 0, 0, 0, CHK_C, CHK_R, 1, CHK_PBUFL, CHK_PDNL, CHK_PDPL);
+	ref.reg.Ta = CHK_TA + _0C;
+	if (shb)
+		thermreg_decim_init(&ref.reg, regb.reg.pbufl, 1 << shb);
+}
 
-	test0();
+// test context - shared by test tasks
+typedef struct
+{
+	int n;               // test number
+	trace_writer_t* ptw; // trace output (null = no trace)
+	result_t* pres;      // test result
+	sched_t* ps;         // scheduler
+} test_t;
 
-	getch();
-	return 0;
+// plant - nozzle simulation step (tested and reference loop)
+void task_plant(void* arg, uint32_t tick)
+{
+	(void)arg;
+	(void)tick;
+	sim_nozzle_cycle(&sim, SIM_DT);
+	sim_nozzle_cycle(&simr, SIM_DT);
+}
+
+// sample temperature of plant 'ps' (thermistor failure in tests 3 and 4) and set input of regulator 'pr'
+void sensor_input(thermreg_avr_t* pr, sim_nozzle_t* ps, int n, float t)
+{
+	float Tc = ps->Ts - _0C;
+	uint16_t adc = sim_nozzle_raw(ps, &ntc);
+	if ((n == 3) && (t >= 100)) Tc = 240;
+	if ((n == 4) && (t >= 100)) Tc = 260;
+	if ((n >= 3) && (t >= 100)) adc = ntc_raw(&ntc, Tc + _0C);
+	if (raw)
+		thermreg_avr_input_raw(pr, adc);
+	else
+		thermreg_avr_input_float(pr, Tc);
 }
 
+// sensor - set regulator inputs (tested and reference loop)
+void task_sensor(void* arg, uint32_t tick)
+{
+	test_t* pt = (test_t*)arg;
+	float t = sched_time(pt->ps, tick);
+	sensor_input(&regb.reg, &sim, pt->n, t);
+	sensor_input(&regr.reg, &simr, pt->n, t);
+}
 
+// regulation cycle (tested and reference loop)
+void task_regulator(void* arg, uint32_t tick)
+{
+	(void)arg;
+	(void)tick;
+	thermreg_avr_cycle_isr(&regb.reg, SHRE, SHRO);
+	thermreg_avr_cycle_isr(&regr.reg, SHRE, SHRO);
+}
 
-void test0(void)
+// power difference check (fixed point in tested loop, float reference in reference loop) - own task period,
+// no cycle counter inside
+void task_check(void* arg, uint32_t tick)
 {
-	float t = 0; // time
-	float dt = SIM_DT; // delta t
-	float temp = 250;
-	reg.Tt = (int16_t)(temp * 16);
-	int c = SIM_MUL;
-	while (t < 500)
+	(void)arg;
+	(void)tick;
+	thermreg_avr_check_cycle(&regb.reg);
+	ref.reg.Tc = (float)regr.reg.Tc / THERMREG_AVR_TMUL + _0C;
+	ref.reg.P = regr.reg.P * CHK_PMAX / 255;
+	thermreg_check_cycle(&ref.reg);
+}
+
+// flight recorder
+void task_recorder(void* arg, uint32_t tick)
+{
+	(void)arg;
+	(void)tick;
+	thermrec_avr_cycle(&rec);
+}
+
+// heater - apply regulator output to plant (heater disconnected in tests 1 and 2, tested and reference loop)
+void task_heater(void* arg, uint32_t tick)
+{
+	test_t* pt = (test_t*)arg;
+	float t = sched_time(pt->ps, tick);
+	int off = ((pt->n == 1) && (t >= 30)) || ((pt->n == 2) && (t >= 100));
+	sim.P = off?0:(regb.reg.P * CHK_PMAX / 255);
+	simr.P = off?0:(regr.reg.P * CHK_PMAX / 255);
+}
+
+// monitor - detection time of first error of both checks
+void task_monitor(void* arg, uint32_t tick)
+{
+	test_t* pt = (test_t*)arg;
+	float t = sched_time(pt->ps, tick);
+	if ((regb.reg.error != 0) && (pt->pres->terror < 0))
 	{
-		sim_nozzle_cycle(&sim, dt);
-		if (++c >= SIM_MUL)
-		{
-			thermreg_avr_input_float(&reg, sim.Ts - _0C);
-			thermreg_avr_cycle(&reg);
-			c = 0;
-		}
-		sim.P = reg.P * 38.0F / 255;
-		// t Tc P
-//		printf("%.2f\t%.2f\t%.2f\n", (double)t, (double)sim.Ts - _0C, (double)reg.P * 38 / 255);
-		float Pp = (reg.Tt - reg.Tc) * reg.kP / (1 << reg.shro);
-		Pp = 38.0F * Pp / 255;
-		float Pi = -reg.kIneg * reg.ebufs / ((1 << reg.shre) * (1 << reg.shro));
-		Pi = 38.0F * Pi / 255;
-		// t Tc P Pp Pi
-		printf("%.2f\t%.2f\t%.2f\t%.0f\t%.0f\n", (double)t, (double)sim.Ts - _0C, (double)reg.P * 38 / 255, Pp, Pi);
-		t += dt;
+		pt->pres->error = regb.reg.error;
+		pt->pres->terror = t;
+	}
+	if ((ref.reg.error != 0) && (pt->pres->terror_ref < 0))
+	{
+		pt->pres->error_ref = ref.reg.error;
+		pt->pres->terror_ref = t;
 	}
 }
 
+// trace output
+void task_trace(void* arg, uint32_t tick)
+{
+	test_t* pt = (test_t*)arg;
+	float t = sched_time(pt->ps, tick);
+	// t Tc P Pc Pda error T Th Ts
+	trace_sample_t ts = {t, (float)regb.reg.Tc / THERMREG_AVR_TMUL + _0C, regb.reg.P * CHK_PMAX / 255, regb.reg.Pc * CHK_PMAX / (4 * 255), thermreg_avr_pda(&regb.reg, CHK_PMAX), regb.reg.error, sim.T, sim.Th, sim.Ts};
+	trace_write(pt->ptw, &ts);
+}
+
+void test(int n, trace_writer_t* ptw, result_t* pres)
+{
+	init();
+	pres->error = pres->error_ref = 0;
+	pres->terror = pres->terror_ref = -1;
+	float temp = 250;
+	regb.reg.Tt = regr.reg.Tt = (int16_t)(temp * 16);
+	test_t tst = {n, ptw, pres, &sched};
+	// periods from task_period (default - plant every tick, regulator tasks every SIM_MUL ticks, check every SIM_MUL *
+	// CHK_NCYCL ticks), order of tasks within tick is fixed
+	// check runs in the same tick as last regulation cycle of its period (phase = check period - regulator period)
+	static sched_func_t* const func[TASK_COUNT] = {task_plant, task_sensor, task_regulator, task_check, task_recorder, task_heater, task_monitor, task_trace};
+	uint32_t phase[TASK_COUNT] = {0};
+	if (task_period[TASK_CHECK] > task_period[TASK_REGULATOR])
+		phase[TASK_CHECK] = task_period[TASK_CHECK] - task_period[TASK_REGULATOR];
+	sched_init(&sched, SIM_DT);
+	int i; for (i = 0; i < TASK_COUNT; i++)
+		if ((i != TASK_TRACE) || ptw)
+			sched_add(&sched, task_name[i], func[i], &tst, task_period[i], phase[i]);
+	sched_run(&sched, SIM_TICKS);
+}
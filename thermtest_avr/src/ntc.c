@@ -0,0 +1,98 @@
+// ntc.c
+
+#include "ntc.h"
+#include <math.h>
+#include <stdlib.h>
+#include "thermreg_avr.h"
+
+
+#define _0C 273.15F
+
+
+void ntc_init(ntc_t* pn)
+{
+	pn->R25 = 100000;
+	pn->beta = 4092;
+	pn->Rp = 4700;
+	pn->adcn = 1024;
+	pn->osn = 16;
+}
+
+uint16_t ntc_raw_max(const ntc_t* pn)
+{
+	return pn->osn * (pn->adcn - 1);
+}
+
+// ADC value without quantization (fraction of one sample)
+static float ntc_adc(const ntc_t* pn, float T)
+{
+	float R = pn->R25 * expf(pn->beta * (1 / T - 1 / (25 + _0C))); // thermistor resistance
+	return pn->adcn * R / (R + pn->Rp);
+}
+
+uint16_t ntc_raw(const ntc_t* pn, float T)
+{
+	float v = ntc_adc(pn, T);
+	uint16_t raw = 0;
+	int k; for (k = 0; k < pn->osn; k++)
+	{
+		float s = floorf(v + (k + 0.5F) / pn->osn - 0.5F); // quantized sample with dither
+		raw += (s < 0)?0:((s > pn->adcn - 1)?(pn->adcn - 1):(uint16_t)s);
+	}
+	return raw;
+}
+
+float ntc_temp(const ntc_t* pn, float raw)
+{
+	float v = (raw + 0.5F * pn->osn) / pn->osn; // ADC value (sum of dithered samples is biased by -osn/2)
+	if (v < 0.001F) v = 0.001F;
+	if (v > pn->adcn - 0.001F) v = pn->adcn - 0.001F;
+	float R = pn->Rp * v / (pn->adcn - v); // thermistor resistance
+	return 1 / (1 / (25 + _0C) + logf(R / pn->R25) / pn->beta);
+}
+
+// table entry [C] * THERMREG_AVR_TMUL
+static int16_t ntc_table_entry(const ntc_t* pn, long raw, float Tmin, float Tmax)
+{
+	float T = ntc_temp(pn, raw) - _0C;
+	if (T < Tmin) T = Tmin;
+	if (T > Tmax) T = Tmax;
+	return (int16_t)lroundf(T * THERMREG_AVR_TMUL);
+}
+
+float ntc_table_write(const ntc_t* pn, FILE* out, uint8_t shift, float Tmin, float Tmax)
+{
+	uint16_t len = (ntc_raw_max(pn) >> shift) + 2;
+	fprintf(out, "// thermreg_avr_ntc.c\n");
+	fprintf(out, "// generated by 'thermtest_avr ntctable' (make -C avr table), do not edit\n");
+	fprintf(out, "// NTC R25=%.0f ohm beta=%.0f K, pullup %.0f ohm, %u level ADC, %u samples summed, %.0f..%.0f C\n\n", pn->R25, pn->beta, pn->Rp, pn->adcn, pn->osn, Tmin, Tmax);
+	fprintf(out, "#include \"thermreg_avr.h\"\n\n\n");
+	fprintf(out, "#if (THERMREG_AVR_NTC_SHIFT != %u) || (THERMREG_AVR_NTC_RAWMAX != %u)\n", shift, ntc_raw_max(pn));
+	fprintf(out, "#error NTC table does not match thermreg_avr.h\n#endif\n\n");
+	fprintf(out, "const int16_t thermreg_avr_ntc[%u] THERMREG_AVR_FLASH =\n{", len);
+	float err = 0;
+	int16_t dmax = 0; // maximum step between entries
+	uint16_t i; for (i = 0; i < len; i++)
+	{
+		int16_t t0 = ntc_table_entry(pn, (long)i << shift, Tmin, Tmax);
+		fprintf(out, "%s%6d,", (i % 16)?"":"\n\t", t0);
+		if (i + 1 == len) break;
+		// interpolation error (same arithmetic as thermreg_avr_input_raw)
+		int16_t t1 = ntc_table_entry(pn, (long)(i + 1) << shift, Tmin, Tmax);
+		if (abs(t1 - t0) > dmax) dmax = abs(t1 - t0);
+		uint16_t f; for (f = 0; (f < (1 << shift)) && (((long)i << shift) + f <= ntc_raw_max(pn)); f++)
+		{
+			float T = ntc_temp(pn, ((long)i << shift) + f) - _0C;
+			if ((T < Tmin) || (T > Tmax)) continue;
+			if ((t0 == (int16_t)lroundf(Tmax * THERMREG_AVR_TMUL)) || (t1 == (int16_t)lroundf(Tmin * THERMREG_AVR_TMUL))) continue; // interval with limited entry
+			int16_t t = t0 + (((int16_t)(t1 - t0) * f + (1 << (shift - 1))) >> shift);
+			float e = fabsf((float)t / THERMREG_AVR_TMUL - T);
+			if (e > err) err = e;
+		}
+	}
+	fprintf(out, "\n};\n");
+	// interpolation product (t1 - t0) * f must fit 16 bits (int on AVR)
+	if ((long)dmax * ((1 << shift) - 1) + (1 << (shift - 1)) > 32767)
+		fprintf(out, "\n#error step between table entries %d is too large for 16 bit interpolation\n", dmax);
+	return err;
+}
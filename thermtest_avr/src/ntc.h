@@ -0,0 +1,42 @@
+// ntc.h
+// NTC thermistor model (beta equation) with pullup divider and oversampled ADC - host side, float
+// forward model (temperature to quantized ADC value) is used by simulator, inverse model generates
+// lookup table of thermreg_avr_input_raw (thermreg_avr_ntc.c)
+
+#ifndef _NTC_H
+#define _NTC_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+
+// thermistor and ADC parameters
+typedef struct
+{
+	float R25;     // [ohm] thermistor resistance at 25C
+	float beta;    // [K] beta constant
+	float Rp;      // [ohm] pullup resistor
+	uint16_t adcn; // number of ADC levels (1024 = 10 bit)
+	uint8_t osn;   // number of summed samples (oversampling), raw value = sum of osn samples
+} ntc_t;
+
+
+// initialize default parameters - 100k thermistor, beta 4092, 4k7 pullup, 10 bit ADC, 16x oversampling
+extern void ntc_init(ntc_t* pn);
+
+// maximum raw value (osn * (adcn - 1))
+extern uint16_t ntc_raw_max(const ntc_t* pn);
+
+// forward model - raw value for temperature 'T' [K], each sample is quantized (floor)
+// samples are dithered by uniform sub-LSB offsets (sensor noise), so oversampling increases resolution
+extern uint16_t ntc_raw(const ntc_t* pn, float T);
+
+// inverse model - temperature [K] for raw value (inverse of ntc_raw without quantization error)
+extern float ntc_temp(const ntc_t* pn, float raw);
+
+// write lookup table source for thermreg_avr_input_raw, table entries at raw values i << shift
+// temperatures are limited to Tmin..Tmax [C], returns maximum interpolation error [C] (intervals with limited entry excluded)
+extern float ntc_table_write(const ntc_t* pn, FILE* out, uint8_t shift, float Tmin, float Tmax);
+
+
+#endif // _NTC_H
@@ -0,0 +1,4 @@
+// pool.c
+// shared with thermtest - the only copy of the source is thermtest/src/pool.c
+
+#include "../../thermtest/src/pool.c"
@@ -0,0 +1,4 @@
+// pool.h
+// shared with thermtest - the only copy of the header is thermtest/src/pool.h
+
+#include "../../thermtest/src/pool.h"
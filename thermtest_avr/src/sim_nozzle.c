@@ -53,3 +53,8 @@ void sim_nozzle_cycle(sim_nozzle_t* ps, float dt)
 //	noise_temp = (((float)rand() / RAND_MAX) - 0.5F) * 2.0F;
 //	temp += noise_temp;
 }
+
+uint16_t sim_nozzle_raw(const sim_nozzle_t* ps, const ntc_t* pn)
+{
+	return ntc_raw(pn, ps->Ts);
+}
@@ -4,6 +4,7 @@
 #define _SIM_NOZZLE_H
 
 #include <inttypes.h>
+#include "ntc.h"
 
 
 typedef struct
@@ -28,5 +29,8 @@ extern void sim_nozzle_init(sim_nozzle_t* ps);
 extern void sim_nozzle_set_extrussion_speed(sim_nozzle_t* ps, float vex);
 extern void sim_nozzle_cycle(sim_nozzle_t* ps, float dt);
 
+// sensor reading as raw ADC value (sum of oversampled quantized samples) of thermistor 'pn' at sensor temperature
+extern uint16_t sim_nozzle_raw(const sim_nozzle_t* ps, const ntc_t* pn);
+
 
 #endif // _SIM_NOZZLE_H
@@ -0,0 +1,76 @@
+// thermrec_avr.c
+
+#include "thermrec_avr.h"
+
+
+void thermrec_avr_init(thermrec_avr_t* prec, thermreg_avr_t* pr, thermrec_avr_sample_t* buff, uint8_t len, uint8_t pre, uint8_t post)
+{
+	prec->pr = pr;         // attached regulator
+	prec->buff = buff;     // sample ring buffer
+	prec->len = len;       // length of sample buffer
+	if (post > len - 1) post = len - 1;
+	if (pre > len - 1 - post) pre = len - 1 - post;
+	prec->pre = pre;       // number of samples before trigger
+	prec->post = post;     // number of samples after trigger
+	thermrec_avr_arm(prec);
+}
+
+void thermrec_avr_cycle(thermrec_avr_t* prec)
+{
+	if (prec->state == thermrec_avr_state_FROZEN)
+		return;
+	thermreg_avr_t* pr = prec->pr;
+	thermrec_avr_sample_t* ps = prec->buff + prec->idx;
+	ps->cycle = prec->cycle++;
+	ps->Tc = pr->Tc;
+	ps->ebufs = pr->ebufs;
+	ps->pbufs = pr->pbufs;
+	ps->Pc = pr->Pc;
+	ps->P = pr->P;
+	ps->error = pr->error;
+	if (++prec->idx >= prec->len) // increment index (wrap by compare)
+		prec->idx = 0;
+	if (prec->count < prec->len) // buffer is not full?
+		prec->count++;
+	if (prec->state == thermrec_avr_state_TRIGGERED)
+	{
+		if (--prec->remain == 0) // all post-trigger samples recorded?
+			prec->state = thermrec_avr_state_FROZEN;
+	}
+	else if (pr->error != thermreg_avr_error_OK)
+		thermrec_avr_trigger(prec);
+}
+
+void thermrec_avr_trigger(thermrec_avr_t* prec)
+{
+	if (prec->state != thermrec_avr_state_ARMED)
+		return;
+	prec->trig = prec->cycle - 1; // last recorded sample is trigger sample
+	prec->remain = prec->post;
+	prec->state = (prec->remain > 0)?thermrec_avr_state_TRIGGERED:thermrec_avr_state_FROZEN;
+}
+
+void thermrec_avr_arm(thermrec_avr_t* prec)
+{
+	prec->idx = 0;
+	prec->count = 0;
+	prec->remain = 0;
+	prec->cycle = 0;
+	prec->trig = 0;
+	prec->state = thermrec_avr_state_ARMED;
+}
+
+uint8_t thermrec_avr_count(thermrec_avr_t* prec)
+{
+	if (prec->state != thermrec_avr_state_FROZEN)
+		return 0;
+	uint16_t n = (uint16_t)prec->pre + 1 + prec->post; // window length
+	return (n < prec->count)?n:prec->count;
+}
+
+const thermrec_avr_sample_t* thermrec_avr_get(thermrec_avr_t* prec, uint8_t i)
+{
+	int16_t j = (int16_t)prec->idx - thermrec_avr_count(prec) + i; // index of sample in ring buffer
+	if (j < 0) j += prec->len;
+	return prec->buff + j;
+}
@@ -0,0 +1,71 @@
+// thermrec_avr.h
+// flight recorder for thermreg_avr_t - keeps last samples in caller provided ring buffer,
+// freezes window of 'pre' samples before and 'post' samples after error is set (trigger)
+// RAM usage on AVR: 16 bytes per sample + 15 bytes recorder structure (e.g. 64 samples = 1039 bytes)
+
+#ifndef _THERMREC_AVR_H
+#define _THERMREC_AVR_H
+
+#include <inttypes.h>
+#include "thermreg_avr.h"
+
+
+// recorder states
+typedef enum
+{
+	thermrec_avr_state_ARMED = 0,     // recording, waiting for trigger
+	thermrec_avr_state_TRIGGERED = 1, // recording post-trigger samples
+	thermrec_avr_state_FROZEN = 2,    // window complete, recording stopped
+} thermrec_avr_state_t;
+
+// one recorded sample - 16 bytes
+typedef struct
+{
+	uint16_t cycle;  // regulator cycle number (low 16 bits)
+	int16_t Tc;      // current temperature [C] * THERMREG_AVR_TMUL
+	int32_t ebufs;   // sum of error buffer
+	int32_t pbufs;   // sum of power difference buffer (average power difference * pbufl)
+	int16_t Pc;      // calculated power (P * 4)
+	uint8_t P;       // output power (0-255)
+	int8_t error;    // regulator error (thermreg_avr_error_t)
+} thermrec_avr_sample_t;
+
+// recorder structure - 15 bytes on AVR
+typedef struct
+{
+	thermreg_avr_t* pr;           // attached regulator
+	thermrec_avr_sample_t* buff;  // sample ring buffer
+	uint8_t len;                  // length of sample buffer
+	uint8_t pre;                  // number of samples before trigger
+	uint8_t post;                 // number of samples after trigger
+	uint8_t idx;                  // index of next sample in buffer
+	uint8_t count;                // count of samples in buffer
+	uint8_t remain;               // remaining post-trigger samples
+	uint8_t state;                // recorder state (thermrec_avr_state_t)
+	uint16_t cycle;               // cycle counter
+	uint16_t trig;                // cycle number of trigger
+} thermrec_avr_t;
+
+
+// attach recorder to regulator, 'buff' is sample buffer of 'len' samples (no allocation)
+// 'pre' + 'post' is limited to 'len' - 1, recorder is armed
+extern void thermrec_avr_init(thermrec_avr_t* prec, thermreg_avr_t* pr, thermrec_avr_sample_t* buff, uint8_t len, uint8_t pre, uint8_t post);
+
+// record one sample, triggers when regulator error is set
+// this function should be called after each call of thermreg_avr_cycle
+extern void thermrec_avr_cycle(thermrec_avr_t* prec);
+
+// manual trigger (same as regulator error)
+extern void thermrec_avr_trigger(thermrec_avr_t* prec);
+
+// empty buffer and arm recorder again
+extern void thermrec_avr_arm(thermrec_avr_t* prec);
+
+// return number of samples in frozen window (0 when not frozen)
+extern uint8_t thermrec_avr_count(thermrec_avr_t* prec);
+
+// return sample 'i' of frozen window (0 = oldest)
+extern const thermrec_avr_sample_t* thermrec_avr_get(thermrec_avr_t* prec, uint8_t i);
+
+
+#endif // _THERMREC_AVR_H
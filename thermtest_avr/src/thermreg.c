@@ -0,0 +1,5 @@
+// thermreg.c
+// float regulator of thermtest - the only copy of the source is thermtest/src/thermreg.c, its thermreg_check is the
+// reference of thermreg_avr_check in tests
+
+#include "../../thermtest/src/thermreg.c"
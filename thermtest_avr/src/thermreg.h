@@ -0,0 +1,4 @@
+// thermreg.h
+// float regulator of thermtest - the only copy of the header is thermtest/src/thermreg.h
+
+#include "../../thermtest/src/thermreg.h"
@@ -2,6 +2,14 @@
 
 #include "thermreg_avr.h"
 #include <stdlib.h>
+#include <math.h>
+
+
+// arithmetic right shift rounding toward zero (same as division for negative values)
+static int32_t thermreg_avr_shr(int32_t v, uint8_t sh)
+{
+	return (v >= 0)?(v >> sh):~(~v >> sh); // complement - right shift - complement
+}
 
 
 void thermreg_avr_input_float(thermreg_avr_t* pr, float Tc)
@@ -9,19 +17,42 @@ void thermreg_avr_input_float(thermreg_avr_t* pr, float Tc)
 	pr->Tc = (int16_t)(Tc * THERMREG_AVR_TMUL + 0.5); // update current temperature variable
 }
 
+void thermreg_avr_input_raw(thermreg_avr_t* pr, uint16_t raw)
+{
+	if (raw > THERMREG_AVR_NTC_RAWMAX) raw = THERMREG_AVR_NTC_RAWMAX;
+	uint8_t i = raw >> THERMREG_AVR_NTC_SHIFT; // table index
+	uint8_t f = raw & ((1 << THERMREG_AVR_NTC_SHIFT) - 1); // fraction between entries
+	int16_t t0 = THERMREG_AVR_FLASH_READ16(thermreg_avr_ntc + i);
+	int16_t t1 = THERMREG_AVR_FLASH_READ16(thermreg_avr_ntc + i + 1);
+	pr->Tc = t0 + (((int16_t)(t1 - t0) * f + (1 << (THERMREG_AVR_NTC_SHIFT - 1))) >> THERMREG_AVR_NTC_SHIFT); // linear interpolation (16 bit product)
+}
+
 void thermreg_avr_cycle(thermreg_avr_t* pr)
 {
 	// calculate regulation
 	int16_t err = pr->Tt - pr->Tc; // regulation error
-	int32_t out = err * pr->kP; // calculate output power (proportional part)
-	// put error value into ring buffer and calculate sum of all values in buffer (ebufs)
-	if (pr->ebufc < pr->ebufl) // error buffer is not full?
-		pr->ebufc++;  // increment count
+	int32_t out = (int32_t)err * pr->kP; // calculate output power (proportional part, 16x16 -> 32 bit, int is 16 bit on AVR)
+	if (pr->ka)
+	{
+		// leaky integrator - ebufs / ebufl is exponential average of error
+		int32_t d = (int32_t)err * pr->ebufl - pr->ebufs;
+		if (d > 8388607) d = 8388607; // limit (product range)
+		if (d < -8388607) d = -8388607;
+		pr->ebufs += thermreg_avr_shr(d * pr->ka, 8);
+	}
 	else
-		pr->ebufs -= pr->ebuff[pr->ebufi]; // subtract old value from error buffer sum
-	pr->ebuff[pr->ebufi] = err; // put new value into buffer
-	pr->ebufs += err; // add new value to error buffer sum
-	pr->ebufi = (pr->ebufi + 1) % pr->ebufl; // increment index
+	{
+		int16_t* ebuff = THERMREG_AVR_EBUFF(pr); // error buffer
+		// put error value into ring buffer and calculate sum of all values in buffer (ebufs)
+		if (pr->ebufc < pr->ebufl) // error buffer is not full?
+			pr->ebufc++;  // increment count
+		else
+			pr->ebufs -= ebuff[pr->ebufi]; // subtract old value from error buffer sum
+		ebuff[pr->ebufi] = err; // put new value into buffer
+		pr->ebufs += err; // add new value to error buffer sum
+		if (++pr->ebufi >= pr->ebufl) // increment index (wrap by compare)
+			pr->ebufi = 0;
+	}
 	int32_t out_i = pr->ebufs * -pr->kIneg; // calculate output power (integration part)
 	if (out_i >= 0) // is positive?
 		out_i >>= pr->shre; // do right shift
@@ -38,6 +69,248 @@ void thermreg_avr_cycle(thermreg_avr_t* pr)
 		pr->P = 0; // set output power to zero
 }
 
+void thermreg_avr_leaky_init(thermreg_avr_t* pr)
+{
+	uint16_t ka = (512 + (pr->ebufl + 1) / 2) / (pr->ebufl + 1); // 2 / (ebufl + 1) * 256 rounded
+	pr->ka = (ka > 255)?255:ka;
+	thermreg_avr_reset(pr);
+}
+
+void thermreg_avr_decim_init(thermreg_avr_t* pr, uint8_t pbufl, uint8_t shb)
+{
+	pr->Pdnls = pr->Pdnls / pr->pbufl * pbufl; // limits are multiples of pbufl
+	pr->Pdpls = pr->Pdpls / pr->pbufl * pbufl;
+	pr->pbufl = pbufl;
+	pr->shb = shb;
+	thermreg_avr_reset(pr);
+}
+
+void thermreg_avr_gains_init(thermreg_avr_t* pr, float kP, float kI, float Pmax)
+{
+	float pu = 255 / Pmax; // output power units per watt
+	float kp = kP * pu / THERMREG_AVR_TMUL; // proportional constant per temperature step without shift
+	float ki = -kI * pu / (THERMREG_AVR_TMUL * pr->ebufl); // integration constant per temperature step of ebufs without shift
+	if (kp < 0) kp = 0;
+	if (ki < 0) ki = 0;
+	uint8_t shro = 15;
+	while ((shro > 0) && (kp * (1L << shro) + 0.5F > 255))
+		shro--;
+	uint8_t shre = 15;
+	while ((shre > 0) && (ki * (1L << (shre + shro)) + 0.5F > 255))
+		shre--;
+	float kpv = kp * (1L << shro) + 0.5F;
+	float kiv = ki * (1L << (shre + shro)) + 0.5F;
+	pr->kP = (kpv > 255)?255:(uint8_t)kpv;
+	pr->kIneg = (kiv > 255)?255:(uint8_t)kiv;
+	pr->shro = shro;
+	pr->shre = shre;
+}
+
+void thermreg_avr_gains(thermreg_avr_t* pr, float Pmax, float* pkP, float* pkI)
+{
+	float wpu = Pmax / 255; // watts per output power unit
+	*pkP = wpu * pr->kP * THERMREG_AVR_TMUL / (1L << pr->shro);
+	*pkI = -wpu * pr->kIneg * THERMREG_AVR_TMUL * pr->ebufl / (1L << (pr->shre + pr->shro));
+}
+
+void thermreg_avr_check_init(thermreg_avr_t* pr, float C, float R, float Pmax, float dt, float Ta, uint8_t ncycl, uint8_t pbufl, float Pdnl, float Pdpl)
+{
+	float pu = 4 * 255 / Pmax; // power units (P * 4) per watt
+	float kE = C / (dt * ncycl) * pu / THERMREG_AVR_TMUL; // energy increase constant (power units per temperature step)
+	float kL = pu / (R * THERMREG_AVR_TMUL); // leakage constant (power units per temperature step)
+	// choose largest shift so that kE < 2^20 (temperature step difference is limited to +-1023) and kL < 2^15
+	uint8_t shc = 16;
+	while ((shc > 0) && ((kE * (1L << shc) >= (1L << 20)) || (kL * (1L << shc) >= (1L << 15))))
+		shc--;
+	pr->shc = shc;
+	pr->kE = (int32_t)(kE * (1L << shc) + 0.5F);
+	pr->kL = (int16_t)(kL * (1L << shc) + 0.5F);
+	pr->Ta = (int16_t)(Ta * THERMREG_AVR_TMUL + 0.5F);
+	pr->ncycl = ncycl;
+	pr->pbufl = pbufl;
+	pr->Pdnls = (int32_t)(Pdnl * pu - 0.5F) * pbufl;
+	pr->Pdpls = (int32_t)(Pdpl * pu + 0.5F) * pbufl;
+	pr->cycl = 0;
+	pr->cpass = 0;
+	pr->pbufs = 0;
+	pr->pbufi = 0;
+	pr->pbufc = 0;
+	pr->pacc = 0;
+	pr->pblkc = 0;
+	pr->shb = 0;
+	pr->est = 0;
+}
+
+void thermreg_avr_est_init(thermreg_avr_t* pr, float Tn, uint8_t shw)
+{
+	float Tl = (Tn * THERMREG_AVR_TMUL - pr->Ta); // nominal leakage regressor (temperature steps)
+	float dTw = 0.5F * 1020 * (1L << pr->shc) / pr->kE * (1L << shw); // nominal temperature change in window (half power)
+	// step of 1/4 of prediction error: 2^shl = 4 * Tl^2 / 2^shc, 2^she = 4 * dTw^2 / 2^(shw + shc)
+	int shl = (int)(log2f(4 * Tl * Tl) + 0.5F) - pr->shc;
+	int she = (int)(log2f(4 * dTw * dTw) + 0.5F) - pr->shc - shw;
+	pr->shl = (shl > 0)?shl:0;
+	pr->she = (she > 0)?she:0;
+	pr->shw = shw;
+	// exponential average with time constant of half of window (2 / (n + 1) of thermreg_check_cycle)
+	int sha = (int)(log2f(0.5F * ((pr->pbufl << pr->shb) + 1)) + 0.5F);
+	pr->sha = (sha > 0)?sha:0;
+	pr->kEe = pr->kE;
+	pr->kLe = pr->kL;
+	pr->pdae = 0;
+	pr->estc = 255;
+	pr->est = 1;
+}
+
+// sum of power difference window (pbufs with current partial block, oldest block weighted by its remaining part)
+static int32_t thermreg_avr_pbufw(thermreg_avr_t* pr)
+{
+	if (pr->pblkc == 0) // block boundary (always when shb = 0)
+		return pr->pbufs;
+	int32_t oldest = (pr->pbufc < pr->pbufl)?0:THERMREG_AVR_PBUFF(pr)[pr->pbufi];
+	return pr->pbufs + thermreg_avr_shr(pr->pacc - oldest * pr->pblkc, pr->shb);
+}
+
+// accumulate window sums in check cycle, update kE and kL at end of window
+static void thermreg_avr_est_cycle(thermreg_avr_t* pr)
+{
+	// healthy heater - no error, average power difference of estimated model within half of limits
+	int32_t pdaw = thermreg_avr_shr(pr->pdae, pr->sha) * 2 * pr->pbufl;
+	if ((pr->error != thermreg_avr_error_OK) || (pdaw <= pr->Pdnls) || (pdaw >= pr->Pdpls))
+		pr->estc = 255; // discard window
+	if (pr->estc == 255) // start of window
+	{
+		if (pr->error != thermreg_avr_error_OK) return;
+		pr->estc = 0;
+		pr->estT0 = pr->Tc;
+		pr->estPs = 0;
+		pr->estTs = 0;
+		return;
+	}
+	pr->estPs += (int16_t)pr->P << 2;
+	pr->estTs += pr->Tc - pr->Ta;
+	if (++pr->estc < (1 << pr->shw))
+		return;
+	int32_t P = pr->estPs >> pr->shw; // average power (P * 4)
+	int32_t Tl = pr->estTs >> pr->shw; // average leakage regressor
+	int32_t dT = pr->Tc - pr->estT0; // temperature change in window
+	if (dT > 511) dT = 511; // limit (product range, kEe up to 4 * kE)
+	if (dT < -511) dT = -511;
+	int32_t pE = thermreg_avr_shr(pr->kE * dT, pr->shw + pr->shc); // energy increase term of nominal model
+	int32_t pc = thermreg_avr_shr(thermreg_avr_shr(pr->kEe * dT, pr->shw) + (int32_t)pr->kLe * Tl, pr->shc); // predicted power
+	int32_t e = P - pc; // prediction error (P * 4)
+	if ((e * 2 * pr->pbufl > pr->Pdnls) && (e * 2 * pr->pbufl < pr->Pdpls)) // not outlier (fault or sudden change)
+	{
+		// rate limit - estimate follows slow drift, step of one window is limited
+		int32_t dE = thermreg_avr_shr(e * dT, pr->she);
+		int32_t dL = thermreg_avr_shr(e * Tl, pr->shl);
+		if (dE > (pr->kE >> 4)) dE = pr->kE >> 4;
+		if (dE < -(pr->kE >> 4)) dE = -(pr->kE >> 4);
+		if (dL > (pr->kL >> 4)) dL = pr->kL >> 4;
+		if (dL < -(pr->kL >> 4)) dL = -(pr->kL >> 4);
+		// no excitation of kE (energy term below 1/16 of positive limit, stable temperature) - only kLe is updated
+		if ((pE < 0 ? -pE : pE) * 16 * pr->pbufl < pr->Pdpls)
+			dE = 0;
+		int32_t kE = pr->kEe + dE;
+		int32_t kL = pr->kLe + dL;
+		// limit estimate to nominal range
+		if (kE < (pr->kE >> 2)) kE = pr->kE >> 2;
+		if (kE > (pr->kE << 2)) kE = pr->kE << 2;
+		if (kL < (pr->kL >> 2)) kL = pr->kL >> 2;
+		if (kL > ((int32_t)pr->kL << 2)) kL = (int32_t)pr->kL << 2;
+		if (kL > 32767) kL = 32767; // kLe range (kL < 2^15)
+		pr->kEe = kE;
+		pr->kLe = kL;
+	}
+	pr->estc = 0; // next window starts here
+	pr->estT0 = pr->Tc;
+	pr->estPs = 0;
+	pr->estTs = 0;
+}
+
+void thermreg_avr_check(thermreg_avr_t* pr)
+{
+	if (++pr->cycl < pr->ncycl)
+		return;
+	pr->cycl = 0; // reset counter
+	thermreg_avr_check_cycle(pr);
+}
+
+void thermreg_avr_check_cycle(thermreg_avr_t* pr)
+{
+	if (!pr->cpass) // first pass - previous temperature not valid (cannot calculate energy increase)
+	{
+		pr->Tcp = pr->Tc;
+		pr->cpass = 1;
+		return;
+	}
+	// calculate power from temperature increase (energy increase) and temperature difference (leakage)
+	int16_t dT = pr->Tc - pr->Tcp; // temperature increase
+	pr->Tcp = pr->Tc;
+	// limit temperature increase (product range - kE * 1023 < 2^30, kL * (Tc - Ta) < 2^28 for sensor range below 2^13 steps)
+	if (dT > 1023) dT = 1023;
+	if (dT < -1023) dT = -1023;
+	int32_t pc = pr->kE * dT + (int32_t)pr->kL * (pr->Tc - pr->Ta);
+	if (pc >= 0) // is positive?
+		pc >>= pr->shc; // do right shift
+	else
+		pc = ~(~pc >> pr->shc); // complement - right shift - complement
+	// power difference between output power and calculated power
+	int32_t pd = ((int16_t)pr->P << 2) - pc;
+	if (pd > 32767) pd = 32767;
+	if (pd < -32767) pd = -32767;
+	pr->Pc = (pc > 32767)?32767:((pc < -32767)?-32767:pc); // calculated power
+	uint8_t supp = 0; // trip suppressed by estimated model
+	if (pr->est)
+	{
+		// power difference of estimated model, exponential average
+		if (dT > 255) dT = 255; // limit (product range, kEe * 255 < 2^30 for kEe up to 4 * kE, leakage term < 2^28)
+		if (dT < -255) dT = -255;
+		int32_t pde = ((int16_t)pr->P << 2) - thermreg_avr_shr(pr->kEe * dT + (int32_t)pr->kLe * (pr->Tc - pr->Ta), pr->shc);
+		if (pde > 32767) pde = 32767;
+		if (pde < -32767) pde = -32767;
+		pr->pdae += pde - thermreg_avr_shr(pr->pdae, pr->sha);
+		int32_t pdaw = thermreg_avr_shr(pr->pdae, pr->sha) * 2 * pr->pbufl;
+		supp = (pdaw > pr->Pdnls) && (pdaw < pr->Pdpls);
+	}
+	// put power difference value into ring buffer and calculate sum of all values in buffer (pbufs)
+	// decimating averager - accumulate block, block average is put into buffer when block is complete
+	if (pr->shb)
+	{
+		pr->pacc += pd;
+		if (++pr->pblkc >= (1 << pr->shb))
+		{
+			pd = thermreg_avr_shr(pr->pacc, pr->shb);
+			pr->pacc = 0;
+			pr->pblkc = 0;
+		}
+	}
+	int16_t* pbuff = THERMREG_AVR_PBUFF(pr); // power difference buffer
+	if (pr->pblkc == 0) // sample or block complete?
+	{
+		if (pr->pbufc < pr->pbufl) // power difference buffer is not full?
+			pr->pbufc++;  // increment count
+		else
+			pr->pbufs -= pbuff[pr->pbufi]; // subtract old value from power difference buffer sum
+		pbuff[pr->pbufi] = pd; // put new value into buffer
+		pr->pbufs += pd; // add new value to power difference buffer sum
+		if (++pr->pbufi >= pr->pbufl) // increment index (wrap by compare)
+			pr->pbufi = 0;
+	}
+	// compare sum with limits multiplied by buffer length (average power difference without division)
+	int32_t pbufw = thermreg_avr_pbufw(pr);
+	if ((pbufw <= pr->Pdnls) && !supp)
+		pr->error = thermreg_avr_error_PDNEGLIM;
+	else if ((pbufw >= pr->Pdpls) && !supp)
+		pr->error = thermreg_avr_error_PDPOSLIM;
+	if (pr->est)
+		thermreg_avr_est_cycle(pr);
+}
+
+float thermreg_avr_pda(thermreg_avr_t* pr, float Pmax)
+{
+	return (float)thermreg_avr_pbufw(pr) / pr->pbufl * Pmax / (4 * 255);
+}
+
 void thermreg_avr_reset(thermreg_avr_t* pr)
 {
 	pr->Tt = 0;       // target temperature [C] * THERMREG_AVR_TMUL
@@ -47,6 +320,17 @@ void thermreg_avr_reset(thermreg_avr_t* pr)
 	pr->ebufc = 0;    // count of samples in error buffer
 	// set output power to zero
 	pr->P = 0;        // current output power [0-255]
+	// reset power difference check
+	pr->cycl = 0;     // error check cycle counter
+	pr->cpass = 0;    // first error check pass
+	pr->Pc = 0;       // calculated power
+	pr->pbufs = 0;    // sum of power difference buffer
+	pr->pbufi = 0;    // index in power difference buffer
+	pr->pbufc = 0;    // count of samples in power difference buffer
+	pr->pacc = 0;     // sum of current block
+	pr->pblkc = 0;    // count of samples in current block
+	pr->estc = 255;   // discard estimation window
+	pr->pdae = 0;     // average power difference of estimated model
 	// reset error
 	pr->error = thermreg_avr_error_OK;
 }
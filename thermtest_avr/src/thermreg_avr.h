@@ -8,6 +8,21 @@
 // temperature multiplier - 16 means resolution 1/16 [C or K]
 #define THERMREG_AVR_TMUL 16
 
+// NTC lookup table (thermreg_avr_ntc.c, generated) - entries at raw values i << THERMREG_AVR_NTC_SHIFT
+// raw value is sum of 16 samples of 10 bit ADC (0..THERMREG_AVR_NTC_RAWMAX)
+#define THERMREG_AVR_NTC_SHIFT  6
+#define THERMREG_AVR_NTC_RAWMAX 16368
+
+// constant tables in flash (AVR program memory)
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define THERMREG_AVR_FLASH PROGMEM
+#define THERMREG_AVR_FLASH_READ16(p) ((int16_t)pgm_read_word(p))
+#else
+#define THERMREG_AVR_FLASH
+#define THERMREG_AVR_FLASH_READ16(p) (*(p))
+#endif
+
 
 // regulator errors
 typedef enum
@@ -22,7 +37,7 @@ typedef enum
 } thermreg_avr_error_t;
 
 
-// regulator structure - 18 bytes
+// regulator structure - 80 bytes on AVR (17 bytes regulation, 37 bytes power check, 26 bytes estimation), buffers are stored inline after structure
 typedef struct
 {
 	// regulation
@@ -30,7 +45,6 @@ typedef struct
 	uint8_t kIneg;   // negative integration constant
 	int16_t Tc;      // current temperature [C] * THERMREG_AVR_TMUL
 	int16_t Tt;      // target temperature [C] * THERMREG_AVR_TMUL
-	int16_t* ebuff;  // error buffer
 	int32_t ebufs;   // sum of error buffer
 	uint8_t ebufi;   // index in error buffer
 	uint8_t ebufc;   // count of samples in error buffer
@@ -39,18 +53,178 @@ typedef struct
 	int8_t error;    // regulator error (thermreg_avr_error_t)
 	uint8_t shre:4;  // right shift of ebufs * kI
 	uint8_t shro:4;  // right shift of output
+	uint8_t ka;      // leaky integrator factor 2 / (ebufl + 1) * 256 (0 = sliding window error buffer, thermreg_avr_leaky_init)
+	// error checking (power difference) - fixed point, power in 1/4 of output power units (P * 4)
+	int16_t Ta;      // ambient temperature [C] * THERMREG_AVR_TMUL
+	int16_t Tcp;     // temperature in previous check cycle [C] * THERMREG_AVR_TMUL
+	int32_t kE;      // energy increase constant - C / (dt * ncycl) scaled to power units per temperature step, << shc
+	int16_t kL;      // leakage constant - 1 / R scaled to power units per temperature step, << shc
+	uint8_t shc;     // right shift of kE and kL products
+	uint8_t ncycl;   // number of regulator cycles per one error check cycle
+	uint8_t cycl;    // error check cycle counter
+	uint8_t cpass;   // first error check pass done (Tcp valid)
+	int16_t Pc;      // calculated power (P * 4)
+	int32_t pbufs;   // sum of power difference buffer
+	uint8_t pbufi;   // index in power difference buffer
+	uint8_t pbufc;   // count of samples in power difference buffer
+	uint8_t pbufl;   // length of power difference buffer
+	int32_t Pdnls;   // negative power difference limit (P * 4) multiplied by pbufl (compared with pbufs)
+	int32_t Pdpls;   // positive power difference limit (P * 4) multiplied by pbufl (compared with pbufs)
+	int32_t pacc;    // sum of power difference in current block (decimating averager)
+	uint8_t pblkc;   // count of samples in current block
+	uint8_t shb;     // block length is 2^shb check cycles (0 = each sample stored, thermreg_avr_decim_init)
+	// online estimation of kE and kL (optional, thermreg_avr_est_init) - LMS on window averages, shifts and multiplications only
+	uint8_t est;     // estimation enabled
+	uint8_t estc;    // count of check cycles in current window (255 = window not started)
+	uint8_t shw;     // window length is 2^shw check cycles
+	uint8_t she;     // right shift of kEe update
+	uint8_t shl;     // right shift of kLe update
+	uint8_t sha;     // right shift of exponential average pdae (time constant 2^sha check cycles)
+	int16_t estT0;   // temperature at start of window [C] * THERMREG_AVR_TMUL
+	int32_t estPs;   // sum of output power in window (P * 4)
+	int32_t estTs;   // sum of temperature difference Tc - Ta in window
+	int32_t kEe;     // estimated kE (limited to kE/4..4*kE, kE stays nominal)
+	int16_t kLe;     // estimated kL (limited to kL/4..4*kL, kL stays nominal)
+	int32_t pdae;    // exponential average of power difference of estimated model (P * 4) << sha
 } thermreg_avr_t;
 
+#ifdef __AVR__
+// structure is not padded on AVR - size in comment above must follow any change of members
+_Static_assert(sizeof(thermreg_avr_t) == 80, "size of thermreg_avr_t differs from comment");
+#endif
+
+// regulator buffers (error buffer and power difference buffer) are stored inline, directly after thermreg_avr_t structure
+// regulator type with buffer capacity 'ebufn' and 'pbufn' is declared with THERMREG_AVR_DEFINE, for example:
+//   THERMREG_AVR_DEFINE(myreg_t, 22, 125);
+//   myreg_t reg;
+// buffer lengths (ebufl, pbufl) must not exceed capacity
+#define THERMREG_AVR_DEFINE(type, ebufn, pbufn) typedef struct { thermreg_avr_t reg; int16_t buff[(ebufn) + (pbufn)]; } type
+
+// number of stored error buffer values (0 in leaky integrator mode)
+#define THERMREG_AVR_EBUFN(pr) ((pr)->ka?0:(pr)->ebufl)
+
+// error buffer and power difference buffer (P * 4) of regulator
+#define THERMREG_AVR_EBUFF(pr) ((int16_t*)((pr) + 1))
+#define THERMREG_AVR_PBUFF(pr) (THERMREG_AVR_EBUFF(pr) + THERMREG_AVR_EBUFN(pr))
+
 
 // set input temperature as float [C]
 // this function should be called before each call of thermreg_avr_cycle with fresh temperature value
 extern void thermreg_avr_input_float(thermreg_avr_t* pr, float Tc);
 
+// set input temperature from raw ADC value (sum of oversampled thermistor readings, 0..THERMREG_AVR_NTC_RAWMAX)
+// lookup in NTC table and linear interpolation - integer only (index by shift, one 16x8 -> 16 bit multiplication,
+// product fits because step between table entries is checked by generator)
+// this function can be used instead of thermreg_avr_input_float
+extern void thermreg_avr_input_raw(thermreg_avr_t* pr, uint16_t raw);
+
+// NTC lookup table - temperature [C] * THERMREG_AVR_TMUL for raw values i << THERMREG_AVR_NTC_SHIFT
+extern const int16_t thermreg_avr_ntc[(THERMREG_AVR_NTC_RAWMAX >> THERMREG_AVR_NTC_SHIFT) + 2] THERMREG_AVR_FLASH;
+
 // do regulation cycle
 // this function must be called periodically in intervals equal to 'dt' (delta-t)
 // when "error" member variable is set, this function does nothing
 extern void thermreg_avr_cycle(thermreg_avr_t* pr);
 
+// worst case cycle count of thermreg_avr_cycle_isr is not measured yet - it is defined here (THERMREG_AVR_CYCLE_ISR_BUDGET)
+// from the first run of cycle bench avr/Makefile (ATmega, avr-gcc -Os, including call and return)
+
+// do regulation cycle - hot path variant for timer ISR, results are identical to thermreg_avr_cycle
+// no division or modulo (ring buffer index wraps by compare), 'shre' and 'shro' must be compile time constants
+// equal to pr->shre and pr->shro (shifts are unrolled at call site instead of loops with variable count)
+// multiplications: err * kP is 16x16 -> 32 bit (kP is 8 bit), ebufs * kIneg is full 32 bit multiplication (ebufs needs
+// 24 bits, |ebufs| <= 255 * 2^15, there is no narrower C type), leaky update d * ka is 32 bit
+static inline __attribute__((always_inline)) void thermreg_avr_cycle_isr(thermreg_avr_t* pr, const uint8_t shre, const uint8_t shro)
+{
+	int16_t err = pr->Tt - pr->Tc; // regulation error
+	int32_t out = (int32_t)err * pr->kP; // proportional part (16x16 -> 32 bit)
+	if (pr->ka)
+	{
+		// leaky integrator (same as thermreg_avr_cycle)
+		int32_t d = (int32_t)err * pr->ebufl - pr->ebufs;
+		if (d > 8388607) d = 8388607; // limit (product range)
+		if (d < -8388607) d = -8388607;
+		d *= pr->ka;
+		pr->ebufs += (d >= 0)?(d >> 8):~(~d >> 8);
+	}
+	else
+	{
+		int16_t* ebuff = (int16_t*)(pr + 1); // error buffer (THERMREG_AVR_EBUFF)
+		uint8_t i = pr->ebufi;
+		if (pr->ebufc < pr->ebufl) // error buffer is not full?
+			pr->ebufc++;  // increment count
+		else
+			pr->ebufs -= ebuff[i]; // subtract old value from error buffer sum
+		ebuff[i] = err; // put new value into buffer
+		pr->ebufs += err; // add new value to error buffer sum
+		if (++i >= pr->ebufl) i = 0; // increment index (wrap by compare)
+		pr->ebufi = i;
+	}
+	int32_t out_i = -(pr->ebufs * pr->kIneg); // integration part (32 bit)
+	if (out_i >= 0) // is positive?
+		out += out_i >> shre; // do right shift
+	else
+		out += ~(~out_i >> shre); // complement - right shift - complement
+	if (out < 0) out = 0; // limit negative output power
+	out >>= shro; // do right shift
+	if (out > 255) out = 255; // limit maximum output power
+	pr->P = (pr->error == thermreg_avr_error_OK)?out:0; // set output power only in case of no error
+}
+
+// switch integration part to leaky integrator - no error buffer (regulator can be declared with ebufn = 0), 4 bytes of state
+// ebufs += ka * (ebufl * err - ebufs) >> 8, ka = 2 / (ebufl + 1) * 256 - ebufs / ebufl is exponential average of error
+// with the same mean delay as sliding window of ebufl samples (same kIneg, shre and ebufl give equivalent closed loop)
+// integration part always opposes error (kI = -kIneg), exponential average is bounded by error range - no windup
+// must be called after thermreg_avr_check_init (power difference buffer moves to start of buffer space), regulator is reset
+extern void thermreg_avr_leaky_init(thermreg_avr_t* pr);
+
+// set regulation constants (kP, shro, kIneg, shre) from float gains, float is used only here to calculate encoding
+// output power [W] = kP * err + kI * average of error buffer, err in [K], 'Pmax' - heater power at P = 255 [W]
+// largest shifts are chosen so that kP and kIneg fit 8 bits (best resolution), ebufl must be set before
+extern void thermreg_avr_gains_init(thermreg_avr_t* pr, float kP, float kI, float Pmax);
+
+// return float gains [W/K] of current encoding (inverse of thermreg_avr_gains_init)
+extern void thermreg_avr_gains(thermreg_avr_t* pr, float Pmax, float* pkP, float* pkI);
+
+// initialize power difference check, float is used only here to calculate scaled constants
+// C - thermal capacity of entire system [J/K], R - thermal resistance between entire system and ambient [K/W]
+// Pmax - heater power at P = 255 [W], dt - regulation period [s], Ta - ambient temperature [C]
+// pbufl - length of power difference buffer (ebufl must be set before), Pdnl/Pdpl - negative/positive power difference limit [W]
+extern void thermreg_avr_check_init(thermreg_avr_t* pr, float C, float R, float Pmax, float dt, float Ta, uint8_t ncycl, uint8_t pbufl, float Pdnl, float Pdpl);
+
+// enable online estimation of kE (capacity) and kL (leakage), must be called after thermreg_avr_check_init and
+// thermreg_avr_decim_init - same algorithm as thermreg_est_init (float), integer only
+// model is fitted to averages over window of 2^shw check cycles, kEe and kLe are updated by LMS step (no division),
+// step is limited to 1/16 of nominal kE and kL per window, estimate stays within 1/4..4x nominal value, kEe is updated
+// only in windows with temperature change (energy term at least 1/16 of positive limit), kLe in every window
+// update shifts are calculated here (float) for adaptation within about 4 windows at nominal temperature 'Tn' [C]
+// power difference window keeps nominal kE and kL - estimated model only suppresses trip while its exponential average
+// power difference pdae (time constant of half of window pbufl * 2^shb) stays within half of limits
+// window is discarded when error is set, pdae or prediction error excess half of limits (fault is not learned)
+extern void thermreg_avr_est_init(thermreg_avr_t* pr, float Tn, uint8_t shw);
+
+// switch power difference buffer to decimating averager - buffer stores averages of blocks of 2^shb check cycles
+// window of pbufl * 2^shb check cycles in pbufl values (e.g. pbufl = 125, shb = 0 -> pbufl = 31, shb = 2 for the same window)
+// partial block is added to window sum and oldest block is weighted by its remaining part (no division, shifts only)
+// error of average against exact moving average is at most step of power difference / (4 * pbufl) plus rounding
+// (one stage, see thermreg_decim_init), with window of thermtest_avr (125 check cycles) thermistor failure of test 4
+// is detected with shb up to 4, shb = 5 (pbufl = 4) misses it
+// must be called after thermreg_avr_check_init (limits are rescaled to new pbufl), regulator is reset
+extern void thermreg_avr_decim_init(thermreg_avr_t* pr, uint8_t pbufl, uint8_t shb);
+
+// check output power vs temperature change, set "error" member variable in case when average power difference excess limits
+// same algorithm as thermreg_check (float), integer only - no division, only shifts and multiplications
+// this function must be called after each call of thermreg_avr_cycle
+extern void thermreg_avr_check(thermreg_avr_t* pr);
+
+// do one error check cycle without cycle counter - for check scheduled with its own period (timer, task scheduler),
+// constants are set by thermreg_avr_check_init with 'dt' * 'ncycl' equal to that period
+// thermreg_avr_check calls it at every 'ncycl'-th call
+extern void thermreg_avr_check_cycle(thermreg_avr_t* pr);
+
+// return average power difference [W] (for diagnostics only - uses float and division)
+extern float thermreg_avr_pda(thermreg_avr_t* pr, float Pmax);
+
 // reset internal control variables, empty buffers, regulation starts from beginning
 // this function must be called to clear "error" member variable
 extern void thermreg_avr_reset(thermreg_avr_t* pr);
@@ -0,0 +1,31 @@
+// thermreg_avr_ntc.c
+// generated by 'thermtest_avr ntctable' (make -C avr table), do not edit
+// NTC R25=100000 ohm beta=4092 K, pullup 4700 ohm, 1024 level ADC, 16 samples summed, -20..320 C
+
+#include "thermreg_avr.h"
+
+
+#if (THERMREG_AVR_NTC_SHIFT != 6) || (THERMREG_AVR_NTC_RAWMAX != 16368)
+#error NTC table does not match thermreg_avr.h
+#endif
+
+const int16_t thermreg_avr_ntc[257] THERMREG_AVR_FLASH =
+{
+	  5120,  5120,  5120,  5120,  5120,  5120,  5039,  4833,  4661,  4514,  4386,  4272,  4171,  4079,  3995,  3918,
+	  3847,  3781,  3720,  3662,  3608,  3557,  3509,  3464,  3420,  3379,  3339,  3301,  3265,  3230,  3197,  3164,
+	  3133,  3103,  3074,  3046,  3018,  2992,  2966,  2941,  2917,  2893,  2870,  2848,  2826,  2804,  2784,  2763,
+	  2743,  2724,  2704,  2686,  2667,  2649,  2631,  2614,  2597,  2580,  2564,  2548,  2532,  2516,  2500,  2485,
+	  2470,  2455,  2441,  2427,  2412,  2398,  2385,  2371,  2358,  2344,  2331,  2318,  2306,  2293,  2280,  2268,
+	  2256,  2244,  2232,  2220,  2208,  2196,  2185,  2173,  2162,  2151,  2140,  2129,  2118,  2107,  2096,  2085,
+	  2075,  2064,  2054,  2043,  2033,  2023,  2013,  2003,  1993,  1983,  1973,  1963,  1953,  1943,  1934,  1924,
+	  1914,  1905,  1895,  1886,  1876,  1867,  1858,  1848,  1839,  1830,  1821,  1812,  1802,  1793,  1784,  1775,
+	  1766,  1757,  1748,  1739,  1731,  1722,  1713,  1704,  1695,  1686,  1678,  1669,  1660,  1651,  1642,  1634,
+	  1625,  1616,  1608,  1599,  1590,  1582,  1573,  1564,  1555,  1547,  1538,  1529,  1521,  1512,  1503,  1495,
+	  1486,  1477,  1468,  1460,  1451,  1442,  1433,  1424,  1415,  1407,  1398,  1389,  1380,  1371,  1362,  1353,
+	  1344,  1335,  1326,  1316,  1307,  1298,  1289,  1279,  1270,  1261,  1251,  1242,  1232,  1222,  1213,  1203,
+	  1193,  1183,  1173,  1163,  1153,  1143,  1133,  1122,  1112,  1101,  1090,  1080,  1069,  1058,  1047,  1036,
+	  1024,  1013,  1001,   989,   977,   965,   953,   941,   928,   915,   902,   889,   875,   862,   847,   833,
+	   819,   804,   788,   773,   757,   741,   724,   706,   689,   670,   651,   632,   612,   590,   568,   546,
+	   522,   496,   470,   442,   412,   380,   346,   308,   267,   222,   171,   111,    41,   -47,  -167,  -320,
+	  -320,
+};
@@ -0,0 +1,5 @@
+// trace.c
+// shared with thermtest - the only copy of the source is thermtest/src/trace.c (both programs write and read
+// the same trace format, one source cannot drift)
+
+#include "../../thermtest/src/trace.c"
@@ -0,0 +1,4 @@
+// trace.h
+// shared with thermtest - the only copy of the header is thermtest/src/trace.h
+
+#include "../../thermtest/src/trace.h"
@@ -0,0 +1,4 @@
+// tsched.c
+// shared with thermtest - the only copy of the source is thermtest/src/tsched.c
+
+#include "../../thermtest/src/tsched.c"
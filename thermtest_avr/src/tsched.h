@@ -0,0 +1,4 @@
+// tsched.h
+// shared with thermtest - the only copy of the header is thermtest/src/tsched.h
+
+#include "../../thermtest/src/tsched.h"
@@ -0,0 +1,4 @@
+// tune.c
+// shared with thermtest - the only copy of the source is thermtest/src/tune.c
+
+#include "../../thermtest/src/tune.c"
@@ -0,0 +1,4 @@
+// tune.h
+// shared with thermtest - the only copy of the header is thermtest/src/tune.h
+
+#include "../../thermtest/src/tune.h"